@@ -37,6 +37,7 @@ The following flags enable optional features (disable with --no-<option name>).
   --debug-symbols          include debug symbols
   --valgrind               Valgrind instrumentation
   --debug-context-mm       use the debug context memory manager
+  --compact-trie           hash-indexed children of node tries
   --statistics             include statistics
   --assertions             turn on assertions
   --tracing                include tracing code
@@ -62,6 +63,7 @@ The following flags enable optional packages (disable with --no-<option name>).
   --cadical                use the CaDiCaL SAT solver [default=yes]
   --cryptominisat          use the CryptoMiniSat SAT solver
   --kissat                 use the Kissat SAT solver
+  --lightgbm               use the LightGBM library for ML models [default=yes]
   --poly                   use the LibPoly library [default=yes]
   --symfpu                 use SymFPU for floating point solver [default=yes]
   --editline               support the editline library
@@ -111,6 +113,7 @@ auto_download=default
 cadical=ON
 cln=default
 comp_inc=default
+compact_trie=default
 coverage=default
 cryptominisat=default
 debug_context_mm=default
@@ -120,6 +123,7 @@ dumping=default
 glpk=default
 gpl=default
 kissat=default
+lightgbm=ON
 poly=ON
 muzzle=default
 ninja=default
@@ -201,9 +205,15 @@ do
     --cadical) cadical=ON;;
     --no-cadical) cadical=OFF;;
 
+    --lightgbm) lightgbm=ON;;
+    --no-lightgbm) lightgbm=OFF;;
+
     --cln) cln=ON;;
     --no-cln) cln=OFF;;
 
+    --compact-trie) compact_trie=ON;;
+    --no-compact-trie) compact_trie=OFF;;
+
     --coverage) coverage=ON;;
     --no-coverage) coverage=OFF;;
 
@@ -336,6 +346,8 @@ cmake_opts=""
   && cmake_opts="$cmake_opts -DENABLE_ASSERTIONS=$assertions"
 [ $comp_inc != default ] \
   && cmake_opts="$cmake_opts -DENABLE_COMP_INC_TRACK=$comp_inc"
+[ $compact_trie != default ] \
+  && cmake_opts="$cmake_opts -DENABLE_COMPACT_TRIE=$compact_trie"
 [ $coverage != default ] \
   && cmake_opts="$cmake_opts -DENABLE_COVERAGE=$coverage"
 [ $debug_symbols != default ] \
@@ -389,6 +401,8 @@ cmake_opts=""
   && cmake_opts="$cmake_opts -DUSE_GLPK=$glpk"
 [ $kissat != default ] \
   && cmake_opts="$cmake_opts -DUSE_KISSAT=$kissat"
+[ $lightgbm != default ] \
+  && cmake_opts="$cmake_opts -DUSE_LIGHTGBM=$lightgbm"
 [ $poly != default ] \
   && cmake_opts="$cmake_opts -DUSE_POLY=$poly"
 [ $symfpu != default ] \
@@ -6800,7 +6800,7 @@ void Solver::printInstantiations(std::ostream& out) const
   d_smtEngine->printInstantiations(out);
   if (options::qlogging())
   {
-    theory::quantifiers::QuantifierLogger::s_logger.print(std::cout);
+    theory::quantifiers::QuantifierLogger::s_logger.print(out);
   }
   ////////
   CVC5_API_TRY_CATCH_END;
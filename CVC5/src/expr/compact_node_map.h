@@ -0,0 +1,346 @@
+/******************************************************************************
+ * This file is part of the cvc5 project.
+ *
+ * Copyright (c) 2009-2021 by the authors listed in the file AUTHORS
+ * in the top-level source directory and their institutional affiliations.
+ * All rights reserved.  See the file COPYING in the top-level source
+ * directory for licensing information.
+ * ****************************************************************************
+ *
+ * A map from nodes to values for the children of tries.
+ */
+
+#include "cvc5_private.h"
+
+#ifndef CVC5__EXPR__COMPACT_NODE_MAP_H
+#define CVC5__EXPR__COMPACT_NODE_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace cvc5 {
+
+/**
+ * A map from nodes (Node or TNode) to values with the interface of the
+ * std::map it replaces in tries, optimized for the low fan-out of most trie
+ * nodes.
+ *
+ * The keys are kept contiguously, together with pointers to the entries, in
+ * insertion order, which is also the iteration order. While there are at most
+ * s_linearLimit of them, a lookup scans the keys; beyond, it uses an
+ * open-addressed table of positions hashed by node id. Comparing keys only
+ * compares the node pointers.
+ *
+ * The entries live in chunks of doubling size, so a map with n entries makes
+ * O(log n) allocations, all freed at once by clear. References to entries
+ * remain valid until they are erased or the map is cleared, as for std::map,
+ * which the tries rely on when they hold pointers to their subtries. The
+ * storage of erased entries is only reclaimed by clear.
+ */
+template <class K, class V>
+class CompactNodeMap
+{
+ public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = std::pair<const K, V>;
+
+ private:
+  /** A key and the entry it maps to. */
+  struct Slot
+  {
+    K d_key;
+    value_type* d_entry;
+  };
+  using Slots = std::vector<Slot>;
+
+  /** Iterator over the entries, in insertion order. */
+  template <class Value, class SlotIterator>
+  class Iterator
+  {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = Value;
+    using pointer = Value*;
+    using reference = Value&;
+
+    Iterator() {}
+    Iterator(SlotIterator it) : d_it(it) {}
+    /** Conversion from iterator to const_iterator. */
+    template <class OtherValue, class OtherSlotIterator>
+    Iterator(const Iterator<OtherValue, OtherSlotIterator>& other)
+        : d_it(other.d_it)
+    {
+    }
+    reference operator*() const { return *d_it->d_entry; }
+    pointer operator->() const { return d_it->d_entry; }
+    Iterator& operator++()
+    {
+      ++d_it;
+      return *this;
+    }
+    Iterator operator++(int)
+    {
+      Iterator it = *this;
+      ++d_it;
+      return it;
+    }
+    bool operator==(const Iterator& other) const { return d_it == other.d_it; }
+    bool operator!=(const Iterator& other) const { return d_it != other.d_it; }
+
+   private:
+    template <class, class>
+    friend class Iterator;
+    SlotIterator d_it;
+  };
+
+ public:
+  using iterator = Iterator<value_type, typename Slots::iterator>;
+  using const_iterator =
+      Iterator<const value_type, typename Slots::const_iterator>;
+
+  CompactNodeMap() {}
+  CompactNodeMap(const CompactNodeMap& other) { insertAll(other); }
+  CompactNodeMap(CompactNodeMap&& other) noexcept { swap(other); }
+  CompactNodeMap& operator=(const CompactNodeMap& other)
+  {
+    if (this != &other)
+    {
+      clear();
+      insertAll(other);
+    }
+    return *this;
+  }
+  CompactNodeMap& operator=(CompactNodeMap&& other) noexcept
+  {
+    if (this != &other)
+    {
+      clear();
+      swap(other);
+    }
+    return *this;
+  }
+  ~CompactNodeMap() { clear(); }
+
+  iterator begin() { return iterator(d_slots.begin()); }
+  iterator end() { return iterator(d_slots.end()); }
+  const_iterator begin() const { return const_iterator(d_slots.begin()); }
+  const_iterator end() const { return const_iterator(d_slots.end()); }
+
+  size_t size() const { return d_slots.size(); }
+  bool empty() const { return d_slots.empty(); }
+
+  iterator find(const K& key)
+  {
+    size_t pos = position(key);
+    return pos == s_none ? end() : iterator(d_slots.begin() + pos);
+  }
+  const_iterator find(const K& key) const
+  {
+    size_t pos = position(key);
+    return pos == s_none ? end() : const_iterator(d_slots.begin() + pos);
+  }
+  size_t count(const K& key) const { return position(key) == s_none ? 0 : 1; }
+
+  /** The value of key, inserting a default constructed one if needed. */
+  V& operator[](const K& key)
+  {
+    size_t pos = position(key);
+    if (pos != s_none)
+    {
+      return d_slots[pos].d_entry->second;
+    }
+    return insertNew(key, V())->second;
+  }
+
+  /** Erase the entry of key, if any, and return the number of erased ones.
+   * Linear in the size of the map. */
+  size_t erase(const K& key)
+  {
+    size_t pos = position(key);
+    if (pos == s_none)
+    {
+      return 0;
+    }
+    d_slots[pos].d_entry->~value_type();
+    d_slots.erase(d_slots.begin() + pos);
+    rebuildTable();
+    return 1;
+  }
+
+  /** Remove all entries and free their storage. */
+  void clear()
+  {
+    for (Slot& s : d_slots)
+    {
+      s.d_entry->~value_type();
+    }
+    Slots().swap(d_slots);
+    std::vector<uint32_t>().swap(d_table);
+    while (d_chunk != nullptr)
+    {
+      Chunk* previous = d_chunk->d_previous;
+      ::operator delete(d_chunk);
+      d_chunk = previous;
+    }
+    d_chunkFree = 0;
+  }
+
+  void swap(CompactNodeMap& other) noexcept
+  {
+    d_slots.swap(other.d_slots);
+    d_table.swap(other.d_table);
+    std::swap(d_shift, other.d_shift);
+    std::swap(d_chunk, other.d_chunk);
+    std::swap(d_chunkFree, other.d_chunkFree);
+  }
+
+ private:
+  /** The header of a chunk of entries, which follow it. */
+  struct Chunk
+  {
+    Chunk* d_previous;
+    size_t d_capacity;
+  };
+  /** The number of keys up to which lookups scan them linearly. */
+  static constexpr size_t s_linearLimit = 8;
+  /** The position returned by position for absent keys. */
+  static constexpr size_t s_none = static_cast<size_t>(-1);
+
+  /** Keys and entries in insertion order */
+  Slots d_slots;
+  /**
+   * Positions in d_slots plus one, or zero for empty cells, indexed by the
+   * hash of the key, or empty while there are at most s_linearLimit keys.
+   * The number of cells is a power of two and at least twice the number of
+   * keys.
+   */
+  std::vector<uint32_t> d_table;
+  /** 64 minus the binary logarithm of the number of cells of d_table */
+  uint32_t d_shift = 64;
+  /** the last allocated chunk */
+  Chunk* d_chunk = nullptr;
+  /** number of unused entries in d_chunk */
+  size_t d_chunkFree = 0;
+
+  /** Offset of the entries of a chunk from its header. */
+  static constexpr size_t entriesOffset()
+  {
+    return (sizeof(Chunk) + alignof(value_type) - 1) / alignof(value_type)
+           * alignof(value_type);
+  }
+  /** Fibonacci hashing of the node id of key. */
+  size_t cell(const K& key) const
+  {
+    return static_cast<size_t>(
+        (static_cast<uint64_t>(key.getId()) * 0x9E3779B97F4A7C15ull)
+        >> d_shift);
+  }
+  size_t position(const K& key) const
+  {
+    if (d_table.empty())
+    {
+      for (size_t i = 0, size = d_slots.size(); i < size; ++i)
+      {
+        if (d_slots[i].d_key == key)
+        {
+          return i;
+        }
+      }
+      return s_none;
+    }
+    const size_t mask = d_table.size() - 1;
+    for (size_t c = cell(key);; c = (c + 1) & mask)
+    {
+      uint32_t p = d_table[c];
+      if (p == 0)
+      {
+        return s_none;
+      }
+      if (d_slots[p - 1].d_key == key)
+      {
+        return p - 1;
+      }
+    }
+  }
+  /** Allocate storage for one more entry. */
+  value_type* allocate()
+  {
+    if (d_chunkFree == 0)
+    {
+      const size_t capacity = d_chunk == nullptr ? 1 : 2 * d_chunk->d_capacity;
+      void* memory =
+          ::operator new(entriesOffset() + capacity * sizeof(value_type));
+      d_chunk = new (memory) Chunk{d_chunk, capacity};
+      d_chunkFree = capacity;
+    }
+    char* entries = reinterpret_cast<char*>(d_chunk) + entriesOffset();
+    return reinterpret_cast<value_type*>(entries)
+           + (d_chunk->d_capacity - d_chunkFree--);
+  }
+  /** Insert key, which is not in the map yet, with the given value. */
+  value_type* insertNew(const K& key, V&& value)
+  {
+    value_type* entry = new (allocate()) value_type(key, std::move(value));
+    d_slots.push_back(Slot{key, entry});
+    if (!d_table.empty() && 2 * d_slots.size() <= d_table.size())
+    {
+      insertIntoTable(d_slots.size() - 1);
+    }
+    else if (d_slots.size() > s_linearLimit)
+    {
+      rebuildTable();
+    }
+    return entry;
+  }
+  void insertIntoTable(size_t pos)
+  {
+    const size_t mask = d_table.size() - 1;
+    size_t c = cell(d_slots[pos].d_key);
+    while (d_table[c] != 0)
+    {
+      c = (c + 1) & mask;
+    }
+    d_table[c] = static_cast<uint32_t>(pos + 1);
+  }
+  /** Recompute d_table for the current keys. */
+  void rebuildTable()
+  {
+    d_table.clear();
+    if (d_slots.size() <= s_linearLimit)
+    {
+      d_table.shrink_to_fit();
+      d_shift = 64;
+      return;
+    }
+    size_t cells = 1;
+    d_shift = 64;
+    while (cells < 2 * d_slots.size())
+    {
+      cells *= 2;
+      d_shift--;
+    }
+    d_table.resize(cells, 0);
+    for (size_t i = 0, size = d_slots.size(); i < size; ++i)
+    {
+      insertIntoTable(i);
+    }
+  }
+  void insertAll(const CompactNodeMap& other)
+  {
+    for (const value_type& e : other)
+    {
+      V value(e.second);
+      insertNew(e.first, std::move(value));
+    }
+  }
+}; /* class CompactNodeMap */
+
+}  // namespace cvc5
+
+#endif /* CVC5__EXPR__COMPACT_NODE_MAP_H */
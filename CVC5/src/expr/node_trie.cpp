@@ -23,8 +23,7 @@ NodeTemplate<ref_count> NodeTemplateTrie<ref_count>::existsTerm(
     const std::vector<NodeTemplate<ref_count>>& reps) const
 {
   const NodeTemplateTrie<ref_count>* tnt = this;
-  typename std::map<NodeTemplate<ref_count>,
-                    NodeTemplateTrie<ref_count>>::const_iterator it;
+  typename ChildMap::const_iterator it;
   for (const NodeTemplate<ref_count>& r : reps)
   {
     it = tnt->d_data.find(r);
@@ -19,6 +19,8 @@
 #define CVC5__EXPR__NODE_TRIE_H
 
 #include <map>
+
+#include "expr/compact_node_map.h"
 #include "expr/node.h"
 
 namespace cvc5 {
@@ -61,8 +63,18 @@ template <bool ref_count>
 class NodeTemplateTrie
 {
  public:
-  /** The children of this node. */
-  std::map<NodeTemplate<ref_count>, NodeTemplateTrie<ref_count>> d_data;
+#ifdef CVC5_COMPACT_TRIE
+  using ChildMap =
+      CompactNodeMap<NodeTemplate<ref_count>, NodeTemplateTrie<ref_count>>;
+#else
+  using ChildMap =
+      std::map<NodeTemplate<ref_count>, NodeTemplateTrie<ref_count>>;
+#endif
+  /**
+   * The children of this node. With the build option ENABLE_COMPACT_TRIE,
+   * they are iterated in insertion order instead of node order.
+   */
+  ChildMap d_data;
   /** For leaf nodes : does this node have data? */
   bool hasData() const { return !d_data.empty(); }
   /** For leaf nodes : get the node corresponding to this leaf. */
@@ -23,6 +23,7 @@
 #include <iostream>
 #include <memory>
 #include <new>
+#include <sstream>
 
 #include "api/cpp/cvc5.h"
 #include "base/configuration.h"
@@ -91,6 +92,196 @@ void printUsage(Options& opts, bool full) {
   }
 }
 
+/**
+ * Parse the given input and execute its commands in the solver of pExecutor
+ * until the end of the input, a quit command, or an error. Returns false if
+ * some command failed.
+ */
+static bool executeInput(Options& opts,
+                         const std::string& filename,
+                         bool inputFromStdin)
+{
+  std::unique_ptr<Command> cmd;
+  bool status = true;
+  if(!opts.wasSetByUserIncrementalSolving()) {
+    cmd.reset(new SetOptionCommand("incremental", "false"));
+    cmd->setMuted(true);
+    pExecutor->doCommand(cmd);
+  }
+
+  ParserBuilder parserBuilder(pExecutor->getSolver(),
+                              pExecutor->getSymbolManager(),
+                              filename,
+                              opts);
+
+  if( inputFromStdin ) {
+#if defined(CVC5_COMPETITION_MODE) && !defined(CVC5_SMTCOMP_APPLICATION_TRACK)
+    parserBuilder.withStreamInput(cin);
+#else  /* CVC5_COMPETITION_MODE && !CVC5_SMTCOMP_APPLICATION_TRACK */
+    parserBuilder.withLineBufferedStreamInput(cin);
+#endif /* CVC5_COMPETITION_MODE && !CVC5_SMTCOMP_APPLICATION_TRACK */
+  }
+
+  std::unique_ptr<Parser> parser(parserBuilder.build());
+  bool interrupted = false;
+  while (status)
+  {
+    if (interrupted) {
+      (*opts.getOut()) << CommandInterrupted();
+      pExecutor->reset();
+      break;
+    }
+    try {
+      cmd.reset(parser->nextCommand());
+      if (cmd == nullptr) break;
+    } catch (UnsafeInterruptException& e) {
+      interrupted = true;
+      continue;
+    }
+
+    status = pExecutor->doCommand(cmd);
+    if (cmd->interrupted() && status == 0) {
+      interrupted = true;
+      break;
+    }
+
+    if(dynamic_cast<QuitCommand*>(cmd.get()) != nullptr) {
+      break;
+    }
+  }
+  return status;
+}
+
+/**
+ * Set the input language from the extension of the input file and the output
+ * language from the input language, unless they were given explicitly.
+ */
+static void detectLanguage(Options& opts,
+                           const std::string& filenameStr,
+                           bool inputFromStdin)
+{
+  const char* filename = filenameStr.c_str();
+  if(opts.getInputLanguage() == language::input::LANG_AUTO) {
+    if( inputFromStdin ) {
+      // We can't do any fancy detection on stdin
+      opts.setInputLanguage(language::input::LANG_CVC);
+    } else {
+      unsigned len = filenameStr.size();
+      if(len >= 5 && !strcmp(".smt2", filename + len - 5)) {
+        opts.setInputLanguage(language::input::LANG_SMTLIB_V2_6);
+      } else if((len >= 2 && !strcmp(".p", filename + len - 2))
+                || (len >= 5 && !strcmp(".tptp", filename + len - 5))) {
+        opts.setInputLanguage(language::input::LANG_TPTP);
+      } else if(( len >= 4 && !strcmp(".cvc", filename + len - 4) )
+                || ( len >= 5 && !strcmp(".cvc4", filename + len - 5) )) {
+        opts.setInputLanguage(language::input::LANG_CVC);
+      } else if((len >= 3 && !strcmp(".sy", filename + len - 3))
+                || (len >= 3 && !strcmp(".sl", filename + len - 3))) {
+        // version 2 sygus is the default
+        opts.setInputLanguage(language::input::LANG_SYGUS_V2);
+      }
+    }
+  }
+
+  if(opts.getOutputLanguage() == language::output::LANG_AUTO) {
+    opts.setOutputLanguage(language::toOutputLanguage(opts.getInputLanguage()));
+  }
+}
+
+/**
+ * Solve the problems listed on standard input one after another, see
+ * --batch. A line holds an input file, optionally followed by a log file
+ * receiving the output of this problem ("-" for the standard output) and by
+ * option=value pairs set for this problem only. Each problem gets a fresh
+ * solver, and --tlimit limits each of its queries, while everything the
+ * process keeps across solvers, in particular the predictors loaded from
+ * model files, is loaded once. When a problem has a log file, its result is
+ * reported on the standard output as the input file followed by the result.
+ * Returns 1 if some problem failed, 0 otherwise.
+ */
+static int runBatch(Options& opts)
+{
+  int returnValue = 0;
+  std::string line;
+  while (std::getline(cin, line))
+  {
+    std::istringstream tokens(line);
+    std::string filename, logname, option;
+    if (!(tokens >> filename))
+    {
+      continue;
+    }
+    tokens >> logname;
+    Options problemOpts;
+    problemOpts.copyValues(opts);
+    std::ofstream log;
+    if (!logname.empty() && logname != "-")
+    {
+      log.open(logname);
+      if (!log)
+      {
+        *opts.getErr() << "(error \"cannot open the log file " << logname
+                       << "\")" << endl;
+        returnValue = 1;
+        continue;
+      }
+      problemOpts.setOut(&log);
+      problemOpts.setErr(&log);
+    }
+    // for the signal handlers' benefit
+    pOptions = &problemOpts;
+    bool status = false;
+    try
+    {
+      while (tokens >> option)
+      {
+        size_t eq = option.find('=');
+        problemOpts.setOption(
+            option.substr(0, eq),
+            eq == std::string::npos ? "true" : option.substr(eq + 1));
+      }
+      detectLanguage(problemOpts, filename, false);
+      (*problemOpts.getOut())
+          << language::SetLanguage(problemOpts.getOutputLanguage());
+      totalTime = std::make_unique<TotalTimer>();
+      pExecutor = std::make_unique<CommandExecutor>(problemOpts);
+      if (problemOpts.getCumulativeTimeLimit() > 0)
+      {
+        pExecutor->getSmtEngine()->setTimeLimit(
+            problemOpts.getCumulativeTimeLimit());
+      }
+      pExecutor->getSmtEngine()->notifyStartParsing(filename);
+      status = executeInput(problemOpts, filename, false);
+      totalTime.reset();
+      pExecutor->flushOutputStreams();
+    }
+    catch (Exception& e)
+    {
+      *problemOpts.getErr() << "(error \"" << e << "\")" << endl;
+    }
+    if (log.is_open())
+    {
+      *opts.getOut() << filename << " ";
+      if (status)
+      {
+        *opts.getOut() << pExecutor->getResult() << endl;
+      }
+      else
+      {
+        *opts.getOut() << "error" << endl;
+      }
+    }
+    totalTime.reset();
+    pExecutor.reset();
+    pOptions = &opts;
+    if (!status)
+    {
+      returnValue = 1;
+    }
+  }
+  return returnValue;
+}
+
 int runCvc5(int argc, char* argv[], Options& opts)
 {
   main::totalTime = std::make_unique<TotalTimer>();
@@ -105,7 +296,8 @@ int runCvc5(int argc, char* argv[], Options& opts)
   // Parse the options
   vector<string> filenames = Options::parseOptions(&opts, argc, argv);
 
-  auto limit = install_time_limit(opts);
+  // in batch mode, the time limit applies to each problem separately
+  auto limit = opts.getBatch() ? TimeLimit() : install_time_limit(opts);
 
   string progNameStr = opts.getBinaryName();
   progName = &progNameStr;
@@ -128,6 +320,27 @@ int runCvc5(int argc, char* argv[], Options& opts)
   *(opts.getOut()) << unitbuf;
 #endif /* CVC5_COMPETITION_MODE */
 
+  // Determine which messages to show based on smtcomp_mode and verbosity
+  if(Configuration::isMuzzledBuild()) {
+    DebugChannel.setStream(&cvc5::null_os);
+    TraceChannel.setStream(&cvc5::null_os);
+    NoticeChannel.setStream(&cvc5::null_os);
+    ChatChannel.setStream(&cvc5::null_os);
+    MessageChannel.setStream(&cvc5::null_os);
+    WarningChannel.setStream(&cvc5::null_os);
+  }
+
+  if (opts.getBatch())
+  {
+    if (!filenames.empty())
+    {
+      throw Exception("--batch reads the input files from standard input.");
+    }
+    int returnValue = runBatch(opts);
+    signal_handlers::cleanup();
+    return returnValue;
+  }
+
   // We only accept one input file
   if(filenames.size() > 1) {
     throw Exception("Too many input files specified.");
@@ -141,7 +354,6 @@ int runCvc5(int argc, char* argv[], Options& opts)
     opts.setInteractive(inputFromStdin && isatty(fileno(stdin)));
   }
 
-  // Auto-detect input language by filename extension
   std::string filenameStr("<stdin>");
   if (!inputFromStdin) {
     // Use swap to avoid copying the string
@@ -150,41 +362,8 @@ int runCvc5(int argc, char* argv[], Options& opts)
   }
   const char* filename = filenameStr.c_str();
 
-  if(opts.getInputLanguage() == language::input::LANG_AUTO) {
-    if( inputFromStdin ) {
-      // We can't do any fancy detection on stdin
-      opts.setInputLanguage(language::input::LANG_CVC);
-    } else {
-      unsigned len = filenameStr.size();
-      if(len >= 5 && !strcmp(".smt2", filename + len - 5)) {
-        opts.setInputLanguage(language::input::LANG_SMTLIB_V2_6);
-      } else if((len >= 2 && !strcmp(".p", filename + len - 2))
-                || (len >= 5 && !strcmp(".tptp", filename + len - 5))) {
-        opts.setInputLanguage(language::input::LANG_TPTP);
-      } else if(( len >= 4 && !strcmp(".cvc", filename + len - 4) )
-                || ( len >= 5 && !strcmp(".cvc4", filename + len - 5) )) {
-        opts.setInputLanguage(language::input::LANG_CVC);
-      } else if((len >= 3 && !strcmp(".sy", filename + len - 3))
-                || (len >= 3 && !strcmp(".sl", filename + len - 3))) {
-        // version 2 sygus is the default
-        opts.setInputLanguage(language::input::LANG_SYGUS_V2);
-      }
-    }
-  }
-
-  if(opts.getOutputLanguage() == language::output::LANG_AUTO) {
-    opts.setOutputLanguage(language::toOutputLanguage(opts.getInputLanguage()));
-  }
-
-  // Determine which messages to show based on smtcomp_mode and verbosity
-  if(Configuration::isMuzzledBuild()) {
-    DebugChannel.setStream(&cvc5::null_os);
-    TraceChannel.setStream(&cvc5::null_os);
-    NoticeChannel.setStream(&cvc5::null_os);
-    ChatChannel.setStream(&cvc5::null_os);
-    MessageChannel.setStream(&cvc5::null_os);
-    WarningChannel.setStream(&cvc5::null_os);
-  }
+  // Auto-detect input language by filename extension
+  detectLanguage(opts, filenameStr, inputFromStdin);
 
   // important even for muzzled builds (to get result output right)
   (*(opts.getOut())) << language::SetLanguage(opts.getOutputLanguage());
@@ -407,52 +586,7 @@ int runCvc5(int argc, char* argv[], Options& opts)
         }
       }
     } else {
-      if(!opts.wasSetByUserIncrementalSolving()) {
-        cmd.reset(new SetOptionCommand("incremental", "false"));
-        cmd->setMuted(true);
-        pExecutor->doCommand(cmd);
-      }
-
-      ParserBuilder parserBuilder(pExecutor->getSolver(),
-                                  pExecutor->getSymbolManager(),
-                                  filename,
-                                  opts);
-
-      if( inputFromStdin ) {
-#if defined(CVC5_COMPETITION_MODE) && !defined(CVC5_SMTCOMP_APPLICATION_TRACK)
-        parserBuilder.withStreamInput(cin);
-#else  /* CVC5_COMPETITION_MODE && !CVC5_SMTCOMP_APPLICATION_TRACK */
-        parserBuilder.withLineBufferedStreamInput(cin);
-#endif /* CVC5_COMPETITION_MODE && !CVC5_SMTCOMP_APPLICATION_TRACK */
-      }
-
-      std::unique_ptr<Parser> parser(parserBuilder.build());
-      bool interrupted = false;
-      while (status)
-      {
-        if (interrupted) {
-          (*opts.getOut()) << CommandInterrupted();
-          pExecutor->reset();
-          break;
-        }
-        try {
-          cmd.reset(parser->nextCommand());
-          if (cmd == nullptr) break;
-        } catch (UnsafeInterruptException& e) {
-          interrupted = true;
-          continue;
-        }
-
-        status = pExecutor->doCommand(cmd);
-        if (cmd->interrupted() && status == 0) {
-          interrupted = true;
-          break;
-        }
-
-        if(dynamic_cast<QuitCommand*>(cmd.get()) != nullptr) {
-          break;
-        }
-      }
+      status = executeInput(opts, filenameStr, inputFromStdin);
     }
 
     api::Result result;
@@ -152,6 +152,7 @@ public:
   options::InstFormatMode getInstFormatMode() const;
   OutputLanguage getOutputLanguage() const;
   bool getUfHo() const;
+  bool getBatch() const;
   bool getDumpInstantiations() const;
   bool getDumpModels() const;
   bool getDumpProofs() const;
@@ -185,6 +186,7 @@ public:
 
   // TODO: Document these.
   void setInputLanguage(InputLanguage);
+  void setErr(std::ostream*);
   void setInteractive(bool);
   void setOut(std::ostream*);
   void setOutputLanguage(OutputLanguage);
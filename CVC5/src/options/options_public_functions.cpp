@@ -54,6 +54,10 @@ OutputLanguage Options::getOutputLanguage() const {
 
 bool Options::getUfHo() const { return (*this)[options::ufHo]; }
 
+bool Options::getBatch() const{
+  return (*this)[options::batch];
+}
+
 bool Options::getDumpInstantiations() const{
   return (*this)[options::dumpInstantiations];
 }
@@ -189,6 +193,10 @@ void Options::setInputLanguage(InputLanguage value) {
   set(options::inputLanguage, value);
 }
 
+void Options::setErr(std::ostream* value) {
+  set(options::err, value);
+}
+
 void Options::setInteractive(bool value) {
   set(options::interactive, value);
 }
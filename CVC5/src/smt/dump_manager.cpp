@@ -49,11 +49,10 @@ void DumpManager::finishInit()
   d_dumpCommands.clear();
   if (options::tcpLearning())
   {
-    TCPClient::sopen();
-    TCPClient::send(d_ss.str().c_str());
+    AlwaysAssert(TCPClient::send(d_ss.str().c_str()) == 0)
+        << "cannot send to the learning server" << std::endl;
     const auto ok = TCPClient::receive();
     AlwaysAssert(ok == "ok") << "instead of ok, received " << ok << std::endl;
-    TCPClient::sclose();
   }
 
   d_fullyInited = true;
@@ -75,12 +74,11 @@ void DumpManager::addToDump(const NodeCommand& c, const char* dumpTag)
       {
         std::stringstream ss;
         ss << "c" << c;
-        TCPClient::sopen();
-        TCPClient::send(ss.str().c_str());
+        AlwaysAssert(TCPClient::send(ss.str().c_str()) == 0)
+            << "cannot send to the learning server" << std::endl;
         const auto ok = TCPClient::receive();
         AlwaysAssert(ok == "ok")
             << "instead of ok, received " << ok << std::endl;
-        TCPClient::sclose();
       }
     }
     else
@@ -115,5 +115,12 @@ void EqEngineManagerDistributed::MasterNotifyClass::eqNotifyNewClass(TNode t)
   d_quantEngine->eqNotifyNewClass(t);
 }
 
+void EqEngineManagerDistributed::MasterNotifyClass::eqNotifyMerge(TNode t1,
+                                                                  TNode t2)
+{
+  // lets the quantifiers term database track changed representatives
+  d_quantEngine->eqNotifyMerge(t1, t2);
+}
+
 }  // namespace theory
 }  // namespace cvc5
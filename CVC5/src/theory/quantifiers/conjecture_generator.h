@@ -106,8 +106,8 @@ class TermGenerator
   //2 : variables must map to non-ground terms
   unsigned d_match_mode;
   //children
-  std::vector<std::map<TNode, TNodeTrie>::iterator> d_match_children;
-  std::vector<std::map<TNode, TNodeTrie>::iterator> d_match_children_end;
+  std::vector<TNodeTrie::ChildMap::iterator> d_match_children;
+  std::vector<TNodeTrie::ChildMap::iterator> d_match_children_end;
 
   void reset( TermGenEnv * s, TypeNode tn );
   bool getNextTerm( TermGenEnv * s, unsigned depth );
@@ -254,7 +254,7 @@ void InstMatchGeneratorMulti::processNewInstantiations(InstMatch& m,
       }
     }
     // shared and set variable, try to merge
-    std::map<Node, InstMatchTrie>::iterator it = tr->d_data.find(n);
+    InstMatchTrie::ChildMap::iterator it = tr->d_data.find(n);
     if (it != tr->d_data.end())
     {
       processNewInstantiations(m,
@@ -281,7 +281,7 @@ void InstMatchGeneratorMulti::processNewInstantiations(InstMatch& m,
       Node en = (*eqc);
       if (en != n)
       {
-        std::map<Node, InstMatchTrie>::iterator itc = tr->d_data.find(en);
+        InstMatchTrie::ChildMap::iterator itc = tr->d_data.find(en);
         if (itc != tr->d_data.end())
         {
           processNewInstantiations(m,
@@ -179,7 +179,7 @@ void InstMatchGeneratorSimple::addInstantiations(InstMatch& m,
     // inst constant from another quantified formula, treat as ground term?
   }
   Node r = d_qstate.getRepresentative(d_match_pattern[argIndex]);
-  std::map<TNode, TNodeTrie>::iterator it = tat->d_data.find(r);
+  TNodeTrie::ChildMap::iterator it = tat->d_data.find(r);
   if (it != tat->d_data.end())
   {
     addInstantiations(m, addedLemmas, argIndex + 1, &(it->second));
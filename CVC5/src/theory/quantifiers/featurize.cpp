@@ -1,34 +1,43 @@
 #include "theory/quantifiers/featurize.h"
 
+#include <algorithm>
 #include <sstream>
 
-#include "theory/quantifiers/term_util.h"
+#include "options/quantifiers_options.h"
 
 namespace cvc5 {
 namespace theory {
 namespace quantifiers {
 
 void featurizeQuantifier(/*out*/ FeatureVector* dest,
-                         const Featurize& quantifierFeatures)
+                         const QuantifierFeatures& quantifierFeatures)
 {
-  quantifierFeatures.addBOWToVector(*dest);
+  dest->addBlock(kind::LAST_KIND - kind::NULL_EXPR, quantifierFeatures.d_bow);
 }
 
 void featurizeTerm(/*out*/ FeatureVector* dest,
-                   const Node term,
+                   const TermFeatures& termFeatures,
                    size_t variableIx,
                    const TermCandidateInfo& termInfo,
-                   const Featurize& quantifierFeatures)
+                   const QuantifierFeatures& quantifierFeatures)
+{
+  featurizeTermStable(
+      dest, termFeatures, variableIx, termInfo, quantifierFeatures);
+  dest->addValue(termInfo.d_tried);
+}
+
+void featurizeTermStable(/*out*/ FeatureVector* dest,
+                         const TermFeatures& termFeatures,
+                         size_t variableIx,
+                         const TermCandidateInfo& termInfo,
+                         const QuantifierFeatures& quantifierFeatures)
 {  // add features for the term
-  Featurize termFeatures(false);
-  termFeatures.count(term);
-  termFeatures.addBOWToVector(*dest);
-  dest->addValue(quantifierFeatures.getVariableFrequency(variableIx));
+  dest->addBlock(kind::LAST_KIND - kind::NULL_EXPR, termFeatures.d_bow);
+  dest->addValue(quantifierFeatures.d_counts.getVariableFrequency(variableIx));
   dest->addValue(termInfo.d_age);
   dest->addValue(termInfo.d_phase);
   dest->addValue(termInfo.d_relevant);
-  dest->addValue(TermUtil::getTermDepth(term));
-  dest->addValue(termInfo.d_tried);
+  dest->addValue(termFeatures.d_depth);
 }
 }  // namespace quantifiers
 }  // namespace theory
@@ -80,34 +89,66 @@ TermTupleFeatureProperties::TermTupleFeatureProperties()
 FeatureVector::FeatureVector(const FeaturePropertiesBase* featureProperties)
     : d_featureProperties(featureProperties)
 {
-  d_values.reserve(d_featureProperties->count());
 }
 Cvc5ostream& operator<<(Cvc5ostream& out, const FeatureVector& features)
 {
-  const auto names = features.d_featureProperties->names();
-  const auto values = features.values();
-  for (size_t i = 0; i < values.size(); i++)
+  const auto& names = features.d_featureProperties->names();
+  const auto& indices = features.indices();
+  const auto& values = features.values();
+  for (size_t i = 0; i < indices.size(); i++)
+  {
+    const auto index = indices[i];
+    out << (i ? " " : "") << names[index] << "(" << index << "):" << values[i];
+  }
+  return out;
+}
+
+void FeatureVector::addBlock(size_t blockSize, const SparseFeatures& entries)
+{
+  Assert(d_size + blockSize <= d_featureProperties->count());
+  for (const auto& [index, value] : entries)
   {
-    const auto value = values[i];
+    Assert(index >= 0 && static_cast<size_t>(index) < blockSize);
+    Assert(d_indices.empty()
+           || static_cast<size_t>(d_indices.back()) < d_size + index);
     if (FP_ZERO != std::fpclassify(value))
     {
-      out << (i ? " " : "") << names[i] << "(" << i << "):" << value;
+      d_indices.push_back(d_size + index);
+      d_values.push_back(value);
     }
   }
-  return out;
+  d_size += blockSize;
 }
 
 void FeatureVector::pop()
 {
   Assert(!d_markers.empty());
-  while (d_values.size() > d_markers.back())
-  {
-    d_values.pop_back();
-  }
+  const auto [entryCount, size] = d_markers.back();
+  d_indices.resize(entryCount);
+  d_values.resize(entryCount);
+  d_size = size;
   d_markers.pop_back();
 }
+
+void FeatureMatrix::addRow(const FeatureVector& row)
+{
+  d_indices.insert(d_indices.end(), row.indices().begin(), row.indices().end());
+  d_values.insert(d_values.end(), row.values().begin(), row.values().end());
+  d_rowStarts.push_back(d_indices.size());
+}
+
 Featurize::Featurize(bool trackBoundVariables)
-    : d_trackBoundVariables(trackBoundVariables)
+    : Featurize(trackBoundVariables,
+                options::featurizeMaxDepth(),
+                options::featurizeMaxSize())
+{
+}
+Featurize::Featurize(bool trackBoundVariables,
+                     size_t maxDepth,
+                     size_t maxSize)
+    : d_trackBoundVariables(trackBoundVariables),
+      d_maxDepth(maxDepth),
+      d_maxSize(maxSize)
 {
 }
 void Featurize::count(TNode n)
@@ -117,15 +158,19 @@ void Featurize::count(TNode n)
   {
     Assert(d_quantifier.isNull());
     d_quantifier = n;
+    for (size_t i = 0; i < n[0].getNumChildren(); i++)
+    {
+      d_boundIndices.insert({n[0][i], i});
+    }
     Trace("featurize") << "[featurize] quantifier: " << n << std::endl;
   }
-  std::vector<TNode> todo;
-  TNode cur;
-  todo.push_back(n);
-  do
+  // breadth-first traversal, the queue holds pairs of a node and its depth
+  std::vector<std::pair<TNode, size_t>> todo;
+  todo.push_back({n, 0});
+  size_t visitedCount = 0;
+  for (size_t head = 0; head < todo.size(); head++)
   {
-    cur = todo.back();
-    todo.pop_back();
+    const auto [cur, depth] = todo[head];
     touch(cur);
     const auto confirmation = d_visited.insert(cur);
     if (!confirmation.second)
@@ -133,40 +178,193 @@ void Featurize::count(TNode n)
       continue;
     }
     visit(cur);
-    todo.insert(todo.end(), cur.begin(), cur.end());
-  } while (!todo.empty());
-  d_quantifier = Node::null();
+    if (d_maxSize > 0 && ++visitedCount >= d_maxSize)
+    {
+      Trace("featurize") << "[featurize] size limit reached" << std::endl;
+      break;
+    }
+    if (d_maxDepth > 0 && depth >= d_maxDepth)
+    {
+      continue;
+    }
+    for (const auto& child : cur)
+    {
+      todo.push_back({child, depth + 1});
+    }
+  }
+  d_quantifier = TNode::null();
+  d_boundIndices.clear();
 }
 
 void Featurize::touch(TNode n)
 {
-  const auto kind = n.getKind();
-  if (d_trackBoundVariables && kind == Kind::BOUND_VARIABLE
-      && !d_quantifier.isNull())
+  if (d_boundIndices.empty() || n.getKind() != Kind::BOUND_VARIABLE)
+  {
+    return;
+  }
+  Trace("featurize") << "[featurize] touching a bound variable: " << n
+                     << std::endl;
+  const auto it = d_boundIndices.find(n);
+  if (it != d_boundIndices.end())
+  {
+    const size_t i = it->second;
+    if (d_boundFrequencies.size() <= i)
+    {
+      d_boundFrequencies.resize(i + 1, 0);
+    }
+    d_boundFrequencies[i]++;
+  }
+}
+void Featurize::visit(TNode n) { increaseFeature(n.getKind()); }
+void Featurize::getBOW(SparseFeatures& out) const
+{
+  out.clear();
+  for (const int kind : d_nonZero)
+  {
+    out.push_back({kind - kind::NULL_EXPR, d_frequencies[kind]});
+  }
+  std::sort(out.begin(), out.end());
+}
+namespace {
+/** The depth of a term as in TermUtil::getTermDepth, which caches it in an
+ * attribute and hence cannot be used concurrently. The traversal does not
+ * recurse, as it runs on worker threads with small stacks. */
+size_t termDepth(TNode n,
+                 std::unordered_map<TNode, size_t, TNodeHashFunction>& cache)
+{
+  // post-order traversal, a term is pushed again below its children, flagged
+  // to be finished once their depths are known
+  std::vector<std::pair<TNode, bool>> todo;
+  todo.push_back({n, false});
+  while (!todo.empty())
   {
-    Trace("featurize") << "[featurize] touching a bound variable: " << n
-                       << std::endl;
-    Node::iterator it =
-        std::find(d_quantifier[0].begin(), d_quantifier[0].end(), n);
-    if (it != d_quantifier[0].end())
+    const auto [cur, finish] = todo.back();
+    todo.pop_back();
+    if (finish)
     {
-      const size_t i = it - d_quantifier[0].begin();
-      if (d_boundFrequencies.size() <= i)
+      size_t depth = 0;
+      for (const TNode child : cur)
       {
-        d_boundFrequencies.resize(i + 1, 0);
+        depth = std::max(depth, cache.at(child) + 1);
+      }
+      cache[cur] = depth;
+      continue;
+    }
+    if (cache.find(cur) != cache.end())
+    {
+      continue;
+    }
+    todo.push_back({cur, true});
+    for (const TNode child : cur)
+    {
+      if (cache.find(child) == cache.end())
+      {
+        todo.push_back({child, false});
       }
-      d_boundFrequencies[i]++;
     }
   }
+  return cache.at(n);
 }
-void Featurize::visit(TNode n) { increaseFeature(n.getKind()); }
-void Featurize::addBOWToVector(FeatureVector& vec) const
+}  // namespace
+
+void FeatureCache::computeTermFeatures(TNode term,
+                                       size_t maxDepth,
+                                       size_t maxSize,
+                                       TermFeatures& features)
 {
-  for (int i = kind::NULL_EXPR; i < kind::LAST_KIND; i++)
+  Featurize termFeatures(false, maxDepth, maxSize);
+  termFeatures.count(term);
+  termFeatures.getBOW(features.d_bow);
+  std::unordered_map<TNode, size_t, TNodeHashFunction> depths;
+  features.d_depth = termDepth(term, depths);
+}
+
+const TermFeatures& FeatureCache::getTermFeatures(TNode term)
+{
+  auto [it, wasInserted] = d_terms.try_emplace(term);
+  auto& features = it->second.d_features;
+  if (wasInserted)
   {
-    const auto k = static_cast<Kind>(i);
-    const auto frequency = getFrequency(k);
-    vec.addValue(frequency);
+    computeTermFeatures(term,
+                        options::featurizeMaxDepth(),
+                        options::featurizeMaxSize(),
+                        features);
+  }
+  it->second.d_lastUsed = d_round;
+  return features;
+}
+
+void FeatureCache::prefetchTermFeatures(const std::vector<Node>& terms,
+                                        size_t threadCount)
+{
+  std::vector<TNode> missing;
+  std::unordered_set<TNode, TNodeHashFunction> seen;
+  for (const Node& term : terms)
+  {
+    const auto it = d_terms.find(term);
+    if (it != d_terms.end())
+    {
+      it->second.d_lastUsed = d_round;
+    }
+    else if (seen.insert(term).second)
+    {
+      missing.push_back(term);
+    }
   }
+  // options are thread local, so they are read here
+  const size_t maxDepth = options::featurizeMaxDepth();
+  const size_t maxSize = options::featurizeMaxSize();
+  // tracing prints nodes, which needs the options too
+  const int threads =
+      Trace.isOn("featurize") ? 1 : std::max<size_t>(threadCount, 1);
+  std::vector<TermFeatures> computed(missing.size());
+#pragma omp parallel for num_threads(threads) schedule(dynamic, 16)
+  for (size_t i = 0; i < missing.size(); i++)
+  {
+    computeTermFeatures(missing[i], maxDepth, maxSize, computed[i]);
+  }
+  for (size_t i = 0; i < missing.size(); i++)
+  {
+    d_terms.emplace(missing[i],
+                    CachedTermFeatures{std::move(computed[i]), d_round});
+  }
+}
+
+void FeatureCache::nextRound(size_t maxAge)
+{
+  d_round++;
+  if (maxAge == 0 || d_round <= maxAge)
+  {
+    return;
+  }
+  for (auto it = d_terms.begin(); it != d_terms.end();)
+  {
+    if (d_round - it->second.d_lastUsed > maxAge)
+    {
+      it = d_terms.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
+
+const QuantifierFeatures& FeatureCache::getQuantifierFeatures(TNode quantifier)
+{
+  auto [it, wasInserted] = d_quantifiers.try_emplace(quantifier);
+  auto& features = it->second;
+  if (wasInserted)
+  {
+    features.d_counts.count(quantifier);
+    features.d_counts.getBOW(features.d_bow);
+  }
+  return features;
+}
+void Featurize::addBOWToVector(FeatureVector& vec) const
+{
+  SparseFeatures bow;
+  getBOW(bow);
+  vec.addBlock(kind::LAST_KIND - kind::NULL_EXPR, bow);
 }
 }  // namespace cvc5
@@ -2,8 +2,10 @@
 #define THEORY_QUANTIFIERS_FEATURIZE_H_9495
 #include <cmath>
 #include <memory>
-#include <set>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "base/check.h"
@@ -62,48 +64,93 @@ class TermTupleFeatureProperties : public FeaturePropertiesBase
   TermTupleFeatureProperties();
   virtual ~TermTupleFeatureProperties(){};
 };
+/** A list of (index, value) pairs of non-zero features, sorted by index. */
+typedef std::vector<std::pair<int32_t, float>> SparseFeatures;
+
 /**\brief  A feature vector, which should respect features set up in
- * FeatureProperties::s_features.*/
+ * FeatureProperties::s_features.
+ *
+ * The vector is stored sparsely, i.e., only the indices and values of the
+ * non-zero features are kept, while size() gives the number of features
+ * added so far (including zeros).*/
 class FeatureVector
 {
  public:
   const FeaturePropertiesBase* d_featureProperties;
   FeatureVector(const FeaturePropertiesBase* featureProperties);
   virtual ~FeatureVector() = default;
-  bool isFull() const
-  {
-    return d_featureProperties->count() == d_values.size();
-  }
+  bool isFull() const { return d_featureProperties->count() == d_size; }
+  /** The number of features added so far. */
+  size_t size() const { return d_size; }
   void addValue(float value)
   {
     Assert(!isFull());
-    d_values.push_back(value);
+    if (FP_ZERO != std::fpclassify(value))
+    {
+      d_indices.push_back(d_size);
+      d_values.push_back(value);
+    }
+    d_size++;
   }
+  /** Add a block of blockSize features, where only the given entries are
+   * non-zero. The indices of the entries are relative to the start of the
+   * block. */
+  void addBlock(size_t blockSize, const SparseFeatures& entries);
   /** When called, the next pop will return to the state.*/
-  void push() { d_markers.push_back(d_values.size()); }
+  void push() { d_markers.push_back({d_indices.size(), d_size}); }
   /**Return to the state marked by last push.*/ void pop();
+  /** Indices of the non-zero features, in increasing order. */
+  const std::vector<int32_t>& indices() const { return d_indices; }
+  /** Values of the non-zero features, aligned with indices(). */
   const std::vector<float>& values() const { return d_values; }
-  const float* rawValues() const { return d_values.data(); }
 
  private:
+  std::vector<int32_t> d_indices;
   std::vector<float> d_values;
-  std::vector<size_t> d_markers;
+  size_t d_size = 0;
+  std::vector<std::pair<size_t, size_t>> d_markers;
 };
 
 Cvc5ostream& operator<<(Cvc5ostream& out, const FeatureVector& features);
 
+/**\brief A batch of feature vectors in the compressed sparse row format, as
+ * expected by PredictorInterface::predictBatchCSR. */
+class FeatureMatrix
+{
+ public:
+  FeatureMatrix() : d_rowStarts(1, 0) {}
+  void addRow(const FeatureVector& row);
+  size_t rowCount() const { return d_rowStarts.size() - 1; }
+  const int32_t* rowStarts() const { return d_rowStarts.data(); }
+  const int32_t* indices() const { return d_indices.data(); }
+  const float* values() const { return d_values.data(); }
+
+ private:
+  std::vector<int32_t> d_rowStarts;
+  std::vector<int32_t> d_indices;
+  std::vector<float> d_values;
+};
+
 /**\brief  A class  used to featurize.
  *
  * Currently we support back of words (BOW).
  * To calculate BOW, run count and then either obtain each frequency bite
  * getFrequency or run addBOWToVector
- * to add all the features to a feature vector.*/
+ * to add all the features to a feature vector.
+ *
+ * The term is traversed breadth-first, so that each distinct subterm is
+ * reached at its smallest depth. The traversal can be bounded by
+ * --featurize-max-depth and --featurize-max-size, in which case deeper
+ * subterms, or subterms beyond the size limit, are not counted.*/
 class Featurize
 {
  public:
   Featurize(bool trackBoundVariables);
+  Featurize(bool trackBoundVariables, size_t maxDepth, size_t maxSize);
   virtual ~Featurize() = default;
   void addBOWToVector(FeatureVector& vec) const;
+  /** The non-zero frequencies of kinds, indexed relative to NULL_EXPR. */
+  void getBOW(SparseFeatures& out) const;
   void count(TNode n);
   int getFrequency(Kind feature) const
   {
@@ -121,10 +168,19 @@ class Featurize
 
  private:
   const bool d_trackBoundVariables;
+  /** limits on the traversal, 0 means unbounded */
+  const size_t d_maxDepth, d_maxSize;
   std::vector<int> d_frequencies, d_boundFrequencies;
-  std::set<Node> d_visited;
-  Node d_quantifier;  // current quantifier being visited, we are assuming we
-                      // cannot visit more than one at a time
+  /** kinds with a non-zero frequency, in the order of their first visit */
+  std::vector<int> d_nonZero;
+  /** nodes visited so far, held by the counted terms; no reference counts
+   * are touched, so that terms can be counted concurrently by several
+   * instances */
+  std::unordered_set<TNode, TNodeHashFunction> d_visited;
+  TNode d_quantifier;  // current quantifier being visited, we are assuming we
+                       // cannot visit more than one at a time
+  /** index of each bound variable of d_quantifier */
+  std::unordered_map<TNode, size_t, TNodeHashFunction> d_boundIndices;
   void visit(TNode n);
   void touch(TNode n);
   int increaseFeature(int id)
@@ -136,19 +192,94 @@ class Featurize
     {
       d_frequencies.resize(index + 1, 0);
     }
+    if (d_frequencies[index] == 0)
+    {
+      d_nonZero.push_back(id);
+    }
     return ++d_frequencies[index];
   }
 };
+
+/**\brief Features of a term that depend only on the term itself.*/
+struct TermFeatures
+{
+  /** BOW of the term, indexed relative to NULL_EXPR. */
+  SparseFeatures d_bow;
+  size_t d_depth = 0;
+};
+
+/**\brief Features of a quantifier that depend only on the quantifier itself.*/
+struct QuantifierFeatures
+{
+  QuantifierFeatures() : d_counts(true) {}
+  /** kind and bound variable frequencies */
+  Featurize d_counts;
+  /** BOW of the quantifier, indexed relative to NULL_EXPR. */
+  SparseFeatures d_bow;
+};
+
+/**\brief A cache of term and quantifier features.
+ *
+ * The features depend only on the structure of a node, so they are calculated
+ * once and reused across quantifiers and rounds. The cache holds on to the
+ * nodes, so their ids are not recycled while they are cached. The features of
+ * terms that are not used for a number of rounds are dropped by nextRound, as
+ * most terms of the early rounds are no longer candidates later.*/
+class FeatureCache
+{
+ public:
+  const TermFeatures& getTermFeatures(TNode term);
+  /** Calculate the features of those of the given terms that are not cached
+   * yet, distributed over threadCount threads. */
+  void prefetchTermFeatures(const std::vector<Node>& terms,
+                            size_t threadCount);
+  const QuantifierFeatures& getQuantifierFeatures(TNode quantifier);
+  /** Start the next round, dropping the features of the terms not used in
+   * the last maxAge rounds, 0 keeps all of them. Invalidates the references
+   * returned by getTermFeatures. */
+  void nextRound(size_t maxAge);
+  void clear()
+  {
+    d_terms.clear();
+    d_quantifiers.clear();
+  }
+
+ private:
+  struct CachedTermFeatures
+  {
+    TermFeatures d_features;
+    /** the last round in which the features were asked for */
+    size_t d_lastUsed;
+  };
+  std::unordered_map<Node, CachedTermFeatures, NodeHashFunction> d_terms;
+  std::unordered_map<Node, QuantifierFeatures, NodeHashFunction> d_quantifiers;
+  /** the current round, see nextRound */
+  size_t d_round = 0;
+  /** Calculate the features of a term with the given traversal limits, does
+   * not access options or create nodes, so it may run on any thread. */
+  static void computeTermFeatures(TNode term,
+                                  size_t maxDepth,
+                                  size_t maxSize,
+                                  TermFeatures& features);
+};
+
 namespace theory {
 namespace quantifiers {
 
 void featurizeQuantifier(/*out*/ FeatureVector* dest,
-                         const Featurize& quantifierFeatures);
+                         const QuantifierFeatures& quantifierFeatures);
 void featurizeTerm(/*out*/ FeatureVector* dest,
-                   const Node term,
+                   const TermFeatures& termFeatures,
                    size_t variableIx,
                    const TermCandidateInfo& termInfo,
-                   const Featurize& quantifierFeatures);
+                   const QuantifierFeatures& quantifierFeatures);
+/** The features of featurizeTerm except for the last one, the number of
+ * tries, which is the only one changing while a quantifier is enumerated. */
+void featurizeTermStable(/*out*/ FeatureVector* dest,
+                         const TermFeatures& termFeatures,
+                         size_t variableIx,
+                         const TermCandidateInfo& termInfo,
+                         const QuantifierFeatures& quantifierFeatures);
 
 }  // namespace quantifiers
 }  // namespace theory
@@ -16,85 +16,157 @@ void IndexTrie::add(const std::vector<bool>& mask,
   d_root = addRec(d_root, 0, cardinality, mask, values);
 }
 
-void IndexTrie::freeRec(IndexTrieNode* n)
+uint32_t IndexTrie::newNode()
 {
-  if (!n)
+  if (!d_free.empty())
+  {
+    const uint32_t n = d_free.back();
+    d_free.pop_back();
+    return n;
+  }
+  AlwaysAssert(d_nodes.size() < s_none) << "index trie too large";
+  d_nodes.push_back(IndexTrieNode{{}, {}, s_none});
+  return d_nodes.size() - 1;
+}
+
+void IndexTrie::freeRec(uint32_t n)
+{
+  if (n == s_matchAll || n == s_none)
   {
     return;
   }
-  for (auto c : n->d_children)
+  // no nodes are allocated while freeing, so the reference stays valid
+  auto& node = d_nodes[n];
+  for (const uint32_t child : node.d_children)
   {
-    freeRec(c.second);
+    freeRec(child);
   }
-  freeRec(n->d_blank);
-  delete n;
+  freeRec(node.d_blank);
+  node.d_values.clear();
+  node.d_children.clear();
+  node.d_blank = s_none;
+  d_free.push_back(n);
 }
 
-bool IndexTrie::findRec(const IndexTrieNode* n,
-                        size_t index,
-                        const std::vector<size_t>& members,
-                        size_t& nonBlankLength) const
+bool IndexTrie::find(const std::vector<size_t>& members,
+                     size_t& nonBlankLength) const
 {
-  if (!n || index >= members.size())
+  // breadth-first, so that the subsuming tuple with the shortest non-blank
+  // prefix is found first, the suffix after its last non-blank position is
+  // represented by s_matchAll
+  nonBlankLength = 0;
+  if (d_root == s_matchAll)
+  {
+    return true;  // everything matches
+  }
+  d_level.assign(1, d_root);
+  for (size_t index = 0; index < members.size() && !d_level.empty(); index++)
   {
-    return true;  // all elements of members matched
+    d_nextLevel.clear();
+    for (const uint32_t n : d_level)
+    {
+      const auto& node = d_nodes[n];
+      const size_t position = findValue(node.d_values, members[index]);
+      if (position != s_none)
+      {
+        const uint32_t child = node.d_children[position];
+        if (child == s_matchAll)
+        {
+          nonBlankLength = index + 1;
+          return true;  // all elements of members matched
+        }
+        d_nextLevel.push_back(child);
+      }
+      if (node.d_blank != s_none)
+      {
+        d_nextLevel.push_back(node.d_blank);
+      }
+    }
+    d_level.swap(d_nextLevel);
   }
-  if (n->d_blank && findRec(n->d_blank, index + 1, members, nonBlankLength))
+  nonBlankLength = members.size();
+  return false;
+}
+
+size_t IndexTrie::findValue(const std::vector<uint32_t>& values, size_t value)
+{
+  const uint32_t* data = values.data();
+  size_t size = values.size();
+  if (size > s_linearSearchSize)
   {
-    return true;  // found in the blank branch
+    // branch-free binary search down to a short range
+    const uint32_t* base = data;
+    while (size > s_linearSearchSize)
+    {
+      const size_t half = size / 2;
+      base = base[half - 1] < value ? base + half : base;
+      size -= half;
+    }
+    data = base;
   }
-  nonBlankLength = index + 1;
-  for (const auto& c : n->d_children)
+  for (size_t i = 0; i < size && data[i] <= value; i++)
   {
-    if (c.first == members[index]
-        && findRec(c.second, index + 1, members, nonBlankLength))
+    if (data[i] == value)
     {
-      return true;  // found in the matching subtree
+      return data + i - values.data();
     }
   }
-  return false;
+  return s_none;
 }
 
-IndexTrieNode* IndexTrie::addRec(IndexTrieNode* n,
-                                 size_t index,
-                                 size_t cardinality,
-                                 const std::vector<bool>& mask,
-                                 const std::vector<size_t>& values)
+uint32_t IndexTrie::addRec(uint32_t n,
+                           size_t index,
+                           size_t cardinality,
+                           const std::vector<bool>& mask,
+                           const std::vector<size_t>& values)
 {
-  if (!n)
+  if (n == s_matchAll)
   {
-    return nullptr;  // this tree matches everything, no point to add
+    return s_matchAll;  // this tree matches everything, no point to add
   }
   if (cardinality == 0)  // all blanks, all strings match
   {
     freeRec(n);
-    return nullptr;
+    return s_matchAll;
   }
 
   Assert(index < mask.size());
+  // the arena may grow in the recursive calls, so nodes are always accessed
+  // through their index afterwards
 
   if (!mask[index])  // blank position in the added vector
   {
-    auto blank = n->d_blank ? n->d_blank : new IndexTrieNode();
-    n->d_blank = addRec(blank, index + 1, cardinality, mask, values);
+    const uint32_t blank =
+        d_nodes[n].d_blank != s_none ? d_nodes[n].d_blank : newNode();
+    const uint32_t newBlank =
+        addRec(blank, index + 1, cardinality, mask, values);
+    d_nodes[n].d_blank = newBlank;
     return n;
   }
   Assert(cardinality);
+  Assert(values[index] < s_none);
 
-  for (auto& edge : n->d_children)
+  const uint32_t value = values[index];
+  const auto& nodeValues = d_nodes[n].d_values;
+  const auto it = std::lower_bound(nodeValues.begin(), nodeValues.end(), value);
+  const size_t position = it - nodeValues.begin();
+  if (it != nodeValues.end() && *it == value)
   {
-    if (edge.first == values[index])
-    {
-      // value already amongst the children
-      edge.second =
-          addRec(edge.second, index + 1, cardinality - 1, mask, values);
-      return n;
-    }
+    // value already amongst the children
+    const uint32_t child = addRec(d_nodes[n].d_children[position],
+                                  index + 1,
+                                  cardinality - 1,
+                                  mask,
+                                  values);
+    d_nodes[n].d_children[position] = child;
+    return n;
   }
   // new child needs to be added
-  auto child =
-      addRec(new IndexTrieNode(), index + 1, cardinality - 1, mask, values);
-  n->d_children.push_back(std::make_pair(values[index], child));
+  const uint32_t child =
+      addRec(newNode(), index + 1, cardinality - 1, mask, values);
+  auto& node = d_nodes[n];
+  node.d_values.insert(node.d_values.begin() + position, value);
+  node.d_children.insert(node.d_children.begin() + position, child);
   return n;
 }
 }  // namespace quantifiers
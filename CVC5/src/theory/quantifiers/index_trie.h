@@ -2,6 +2,8 @@
 #define CVC5__THEORY__QUANTIFIERS__INDEX_TRIE_H
 
 #include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <utility>
 #include <vector>
 
@@ -11,11 +13,14 @@ namespace cvc5 {
 namespace theory {
 namespace quantifiers {
 
-/** A single node of the IndexTrie. */
+/** A single node of the IndexTrie, addressed by its index in the arena of
+ * the trie. The values of the children are kept sorted, separately from the
+ * children, so that they can be searched without touching the children. */
 struct IndexTrieNode
 {
-  std::vector<std::pair<size_t, IndexTrieNode*>> d_children;
-  IndexTrieNode* d_blank = nullptr;
+  std::vector<uint32_t> d_values;
+  std::vector<uint32_t> d_children;
+  uint32_t d_blank;
 };
 
 /** Trie of  sequences indices, used to check for subsequence membership.
@@ -36,8 +41,12 @@ struct IndexTrieNode
  * is treated as a sequence of integers with a special symbol for blank, which
  * is in fact stored  in a special  child (member d_blank).  As a small
  * optimization, a suffix containing only blanks is represented by  the empty
- * subtree, i.e., a null pointer.
+ * subtree, i.e., the index s_matchAll.
  *
+ * Nodes live in a single arena and refer to each other by indices, nodes of
+ * subtrees that become redundant are recycled. The child of a node for a
+ * given value is found by a binary search over the sorted values of its
+ * children, short ranges are scanned linearly.
  */
 class IndexTrie
 {
@@ -46,48 +55,61 @@ class IndexTrie
    *  the data structure will  store only data structure containing at least
    *  one blank. */
   IndexTrie(bool ignoreFullySpecified)
-      : d_ignoreFullySpecified(ignoreFullySpecified),
-        d_root(new IndexTrieNode())
+      : d_ignoreFullySpecified(ignoreFullySpecified), d_root(newNode())
   {
   }
 
-  virtual ~IndexTrie() { freeRec(d_root); }
+  virtual ~IndexTrie() = default;
 
   /**  Add a tuple of values into the trie  masked by a bitmask, i.e.\ position
    * i is considered blank iff mask[i] is false. */
   void add(const std::vector<bool>& mask, const std::vector<size_t>& values);
 
   /** Check if the given set of indices is subsumed by something present in the
-   * trie. If it is subsumed, give the maximum non-blank index. */
+   * trie. If it is subsumed, give the least nonBlankLength such that a tuple
+   * in the trie subsuming the members has blanks only from nonBlankLength on.
+   * So any tuple agreeing with members on the first nonBlankLength positions
+   * is subsumed as well, and enumerations need to change one of these
+   * positions to escape. If it is not subsumed, nonBlankLength is the size of
+   * members. */
   bool find(const std::vector<size_t>& members,
-            /*out*/ size_t& nonBlankLength) const
-  {
-    nonBlankLength = 0;
-    return findRec(d_root, 0, members, nonBlankLength);
-  }
+            /*out*/ size_t& nonBlankLength) const;
+
+  /** The number of nodes in use. */
+  size_t size() const { return d_nodes.size() - d_free.size(); }
 
  private:
+  /** index of the empty subtree, which matches everything */
+  static constexpr uint32_t s_matchAll = std::numeric_limits<uint32_t>::max();
+  /** index of a missing blank child */
+  static constexpr uint32_t s_none = s_matchAll - 1;
   /**  ignore tuples with no blanks in the add method */
   const bool d_ignoreFullySpecified;
-  /**  the root of the trie, becomes null, if all tuples should match */
-  IndexTrieNode* d_root;
-
-  /** Auxiliary recursive function for cleanup. */
-  void freeRec(IndexTrieNode* n);
+  /** the arena of nodes */
+  std::vector<IndexTrieNode> d_nodes;
+  /** indices of recycled nodes in the arena */
+  std::vector<uint32_t> d_free;
+  /**  the root of the trie, becomes s_matchAll, if all tuples should match */
+  uint32_t d_root;
+  /** the nodes of the current and of the next level in find, kept to avoid
+   * allocations */
+  mutable std::vector<uint32_t> d_level, d_nextLevel;
 
-  /** Auxiliary recursive function for finding  subsuming tuple. */
-  bool findRec(const IndexTrieNode* n,
-               size_t index,
-               const std::vector<size_t>& members,
-               size_t& nonBlankLength) const;
+  /** ranges of at most this size are searched linearly */
+  static constexpr size_t s_linearSearchSize = 16;
+  /** The position of value in the sorted values, s_none if not present. */
+  static size_t findValue(const std::vector<uint32_t>& values, size_t value);
+  uint32_t newNode();
+  /** Recycle the nodes of a subtree. */
+  void freeRec(uint32_t n);
 
   /** Add master values  starting from index  to a given subtree. The
    * cardinality represents the number of non-blank elements left. */
-  IndexTrieNode* addRec(IndexTrieNode* n,
-                        size_t index,
-                        size_t cardinality,
-                        const std::vector<bool>& mask,
-                        const std::vector<size_t>& values);
+  uint32_t addRec(uint32_t n,
+                  size_t index,
+                  size_t cardinality,
+                  const std::vector<bool>& mask,
+                  const std::vector<size_t>& values);
 };
 
 }  // namespace quantifiers
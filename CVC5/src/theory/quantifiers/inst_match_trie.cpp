@@ -52,7 +52,7 @@ bool InstMatchTrie::addInstMatch(quantifiers::QuantifiersState& qs,
   }
   unsigned i_index = imtio ? imtio->d_order[index] : index;
   Node n = m[i_index];
-  std::map<Node, InstMatchTrie>::iterator it = d_data.find(n);
+  InstMatchTrie::ChildMap::iterator it = d_data.find(n);
   if (it != d_data.end())
   {
     bool ret =
@@ -73,7 +73,7 @@ bool InstMatchTrie::addInstMatch(quantifiers::QuantifiersState& qs,
         Node en = (*eqc);
         if (en != n)
         {
-          std::map<Node, InstMatchTrie>::iterator itc = d_data.find(en);
+          InstMatchTrie::ChildMap::iterator itc = d_data.find(en);
           if (itc != d_data.end())
           {
             if (itc->second.addInstMatch(
@@ -103,7 +103,7 @@ bool InstMatchTrie::removeInstMatch(Node q,
   Assert(!imtio || index < imtio->d_order.size());
   unsigned i_index = imtio ? imtio->d_order[index] : index;
   Node n = m[i_index];
-  std::map<Node, InstMatchTrie>::iterator it = d_data.find(n);
+  InstMatchTrie::ChildMap::iterator it = d_data.find(n);
   if (it != d_data.end())
   {
     if ((index + 1) == q[0].getNumChildren()
@@ -22,6 +22,7 @@
 
 #include "context/cdlist.h"
 #include "context/cdo.h"
+#include "expr/compact_node_map.h"
 #include "expr/node.h"
 
 namespace cvc5 {
@@ -98,8 +99,13 @@ class InstMatchTrie
   void clear();
   /** print this class */
   void print(std::ostream& out, Node q) const;
+#ifdef CVC5_COMPACT_TRIE
+  using ChildMap = CompactNodeMap<Node, InstMatchTrie>;
+#else
+  using ChildMap = std::map<Node, InstMatchTrie>;
+#endif
   /** the data */
-  std::map<Node, InstMatchTrie> d_data;
+  ChildMap d_data;
 
  private:
   /** Helper for getInstantiations.*/
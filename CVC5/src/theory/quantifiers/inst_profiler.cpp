@@ -0,0 +1,199 @@
+#include "theory/quantifiers/inst_profiler.h"
+
+#include <fstream>
+#include <sstream>
+
+#include "options/option_exception.h"
+#include "theory/quantifiers/quantifier_logger.h"
+
+namespace cvc5 {
+namespace theory {
+namespace quantifiers {
+
+namespace {
+/** The text of n, as printed. */
+std::string toString(Node n)
+{
+  std::stringstream ss;
+  ss << n;
+  return ss.str();
+}
+
+/** Write s as a quoted CSV field. */
+void writeCsvString(std::ostream& out, const std::string& s)
+{
+  out << '"';
+  for (char c : s)
+  {
+    out << (c == '"' ? "\"\"" : std::string(1, c));
+  }
+  out << '"';
+}
+
+/** Write s as a JSON string. */
+void writeJsonString(std::ostream& out, const std::string& s)
+{
+  out << '"';
+  for (char c : s)
+  {
+    switch (c)
+    {
+      case '"': out << "\\\""; break;
+      case '\\': out << "\\\\"; break;
+      case '\n': out << "\\n"; break;
+      case '\t': out << "\\t"; break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20)
+        {
+          out << "\\u00" << "0123456789abcdef"[(c >> 4) & 0xf]
+              << "0123456789abcdef"[c & 0xf];
+        }
+        else
+        {
+          out << c;
+        }
+    }
+  }
+  out << '"';
+}
+
+/** Write the numbers separated by sep. */
+void writeList(std::ostream& out,
+               const std::vector<size_t>& numbers,
+               const char* sep)
+{
+  for (size_t i = 0; i < numbers.size(); i++)
+  {
+    out << (i > 0 ? sep : "") << numbers[i];
+  }
+}
+}  // namespace
+
+InstProfiler::InstProfiler(const std::string& fileName) : d_out(fileName)
+{
+  if (!d_out.is_open())
+  {
+    throw OptionException("cannot open the file of --fs-profile: " + fileName);
+  }
+  const std::string json = ".json";
+  d_json = fileName.size() >= json.size()
+           && fileName.compare(fileName.size() - json.size(), json.size(), json)
+                  == 0;
+  if (d_json)
+  {
+    d_out << '[';
+  }
+  else
+  {
+    d_out << "round,effort,quantifier,ml,candidates,tuples,success,"
+             "enumerate_ms,featurize_ms,predict_ms,instantiate_ms,ranks,useful"
+          << std::endl;
+  }
+}
+
+InstProfiler::Record& InstProfiler::add(Node quantifier, size_t round, bool rd)
+{
+  writeRecord();
+  d_record = Record();
+  d_record.d_quantifier = quantifier;
+  d_record.d_round = round;
+  d_record.d_rd = rd;
+  d_hasRecord = true;
+  return d_record;
+}
+
+void InstProfiler::flush()
+{
+  writeRecord();
+  d_out.flush();
+}
+
+void InstProfiler::write()
+{
+  writeRecord();
+  if (d_json)
+  {
+    d_out << "\n]" << std::endl;
+  }
+  d_out.flush();
+}
+
+void InstProfiler::writeRecord()
+{
+  if (!d_hasRecord)
+  {
+    return;
+  }
+  if (d_json)
+  {
+    writeJson(d_record);
+  }
+  else
+  {
+    writeCsv(d_record);
+  }
+  d_hasRecord = false;
+  d_written++;
+}
+
+int InstProfiler::isUseful(const Record& r)
+{
+  QuantifierLogger& logger = QuantifierLogger::s_logger;
+  if (!r.d_success || !logger.hasUsefulInstantiations())
+  {
+    return -1;
+  }
+  if (!logger.hasQuantifier(r.d_quantifier))
+  {
+    return 0;
+  }
+  const QuantifierLogger::QuantifierInfo& info =
+      logger.getQuantifierInfo(r.d_quantifier);
+  const QuantifierLogger::NodeVector terms(r.d_terms);
+  return info.d_usefulInstantiations.count(terms) > 0 ? 1 : 0;
+}
+
+void InstProfiler::writeCsv(const Record& r)
+{
+  d_out << r.d_round << ',' << (r.d_rd ? "rd" : "ground") << ',';
+  writeCsvString(d_out, toString(r.d_quantifier));
+  d_out << ',' << r.d_ml << ',';
+  writeList(d_out, r.d_candidates, " ");
+  d_out << ',' << r.d_tuples << ',' << r.d_success << ',' << r.d_enumerateTime
+        << ',' << r.d_featurizeTime << ',' << r.d_predictTime << ','
+        << r.d_instantiateTime << ',';
+  writeList(d_out, r.d_ranks, " ");
+  d_out << ',';
+  const int useful = isUseful(r);
+  if (useful >= 0)
+  {
+    d_out << useful;
+  }
+  d_out << '\n';
+}
+
+void InstProfiler::writeJson(const Record& r)
+{
+  d_out << (d_written > 0 ? ",\n " : "\n ") << "{\"round\": " << r.d_round
+        << ", \"effort\": \"" << (r.d_rd ? "rd" : "ground")
+        << "\", \"quantifier\": ";
+  writeJsonString(d_out, toString(r.d_quantifier));
+  d_out << ", \"ml\": " << (r.d_ml ? "true" : "false")
+        << ", \"candidates\": [";
+  writeList(d_out, r.d_candidates, ", ");
+  d_out << "], \"tuples\": " << r.d_tuples
+        << ", \"success\": " << (r.d_success ? "true" : "false")
+        << ", \"enumerate_ms\": " << r.d_enumerateTime
+        << ", \"featurize_ms\": " << r.d_featurizeTime
+        << ", \"predict_ms\": " << r.d_predictTime
+        << ", \"instantiate_ms\": " << r.d_instantiateTime
+        << ", \"ranks\": [";
+  writeList(d_out, r.d_ranks, ", ");
+  const int useful = isUseful(r);
+  d_out << "], \"useful\": "
+        << (useful < 0 ? "null" : (useful > 0 ? "true" : "false")) << '}';
+}
+
+}  // namespace quantifiers
+}  // namespace theory
+}  // namespace cvc5
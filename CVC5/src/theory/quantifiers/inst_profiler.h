@@ -0,0 +1,131 @@
+#ifndef CVC5__THEORY__QUANTIFIERS__INST_PROFILER_H
+#define CVC5__THEORY__QUANTIFIERS__INST_PROFILER_H
+
+#include <chrono>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "expr/node.h"
+
+namespace cvc5 {
+namespace theory {
+namespace quantifiers {
+
+/**\brief Per-quantifier profile of enumerative instantiation (--fs-profile).
+ *
+ * InstStrategyEnum adds a record each time it processes a quantifier, that
+ * is, for each quantifier, round and effort (relevant domain or ground
+ * terms). Each record is written once the next one is started or the round
+ * ends, as CSV, or as a JSON array of objects if the file name ends with
+ * ".json", and the file is flushed at the end of each round, so that the
+ * profile of an interrupted run is kept. The fields are:
+ *  - round: the full saturation round, counting from 1,
+ *  - effort: "rd" for relevant domain, "ground" for ground terms,
+ *  - quantifier: the quantifier as printed,
+ *  - ml: whether the candidate terms were ordered by the ML model,
+ *  - candidates: the number of candidate terms of each variable,
+ *  - tuples: the number of tuples tried,
+ *  - success: whether an instantiation was added (with --fs-batch, its lemma
+ *    may still turn out to be a duplicate),
+ *  - enumerate_ms, featurize_ms, predict_ms, instantiate_ms: the time spent
+ *    in the tuple enumerator, in featurizing and in scoring the candidate
+ *    terms, and in Instantiate::addInstantiationExpFail,
+ *  - ranks: for a successful record, the position of the term of each
+ *    variable in the order of the term producer, which is the ML rank of the
+ *    term if ml is set,
+ *  - useful: for a successful record, whether the instantiation was useful,
+ *    known only if the quantifier logger registered the useful
+ *    instantiations (--qlogging with --dump-instantiations) before the record
+ *    was written, that is, after an earlier check-sat of an incremental run,
+ *    empty otherwise.
+ * In CSV, the numbers of candidates and ranks are separated by spaces.
+ *
+ * The featurize and predict times of a quantifier whose terms were scored
+ * together with the other quantifiers (--ml-threads) do not include the
+ * features of terms shared by the quantifiers.
+ */
+class InstProfiler
+{
+ public:
+  struct Record
+  {
+    Node d_quantifier;
+    size_t d_round = 0;
+    bool d_rd = false;
+    bool d_ml = false;
+    std::vector<size_t> d_candidates;
+    size_t d_tuples = 0;
+    bool d_success = false;
+    /** times in milliseconds */
+    double d_enumerateTime = 0;
+    double d_featurizeTime = 0;
+    double d_predictTime = 0;
+    double d_instantiateTime = 0;
+    std::vector<size_t> d_ranks;
+    /** the terms of the successful instantiation */
+    std::vector<Node> d_terms;
+  };
+
+  /** Adds the time of its scope, in milliseconds, to a total if it is not
+   * null. */
+  class Timer
+  {
+   public:
+    Timer(double* total) : d_total(total)
+    {
+      if (d_total != nullptr)
+      {
+        d_start = std::chrono::steady_clock::now();
+      }
+    }
+    ~Timer()
+    {
+      if (d_total != nullptr)
+      {
+        const std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - d_start;
+        *d_total += elapsed.count();
+      }
+    }
+
+   private:
+    double* d_total;
+    std::chrono::steady_clock::time_point d_start;
+  };
+
+  /** Profile to the given file, throws an OptionException if it cannot be
+   * opened for writing. Writes the CSV header or opens the JSON array. */
+  InstProfiler(const std::string& fileName);
+  /** Start a record, after writing the previous one. The reference stays
+   * valid until the next call. */
+  Record& add(Node quantifier, size_t round, bool rd);
+  /** Write the current record and flush the file, at the end of a round. */
+  void flush();
+  /** Write the current record and close the JSON array. */
+  void write();
+
+ private:
+  /** Whether the instantiation of r was useful: 1, 0, or -1 if unknown. */
+  static int isUseful(const Record& r);
+  /** Write the current record, if any. */
+  void writeRecord();
+  void writeCsv(const Record& r);
+  void writeJson(const Record& r);
+
+  std::ofstream d_out;
+  /** whether to write JSON rather than CSV */
+  bool d_json;
+  /** the record being filled in, if d_hasRecord */
+  Record d_record;
+  bool d_hasRecord = false;
+  /** the number of records written so far */
+  size_t d_written = 0;
+};
+
+}  // namespace quantifiers
+}  // namespace theory
+}  // namespace cvc5
+
+#endif /* CVC5__THEORY__QUANTIFIERS__INST_PROFILER_H */
@@ -1,7 +1,10 @@
 
 #include "theory/quantifiers/inst_strategy_enumerative.h"
 
+#include <algorithm>
+
 #include "options/quantifiers_options.h"
+#include "theory/quantifiers/inst_profiler.h"
 #include "theory/quantifiers/instantiate.h"
 #include "theory/quantifiers/quantifier_logger.h"
 #include "theory/quantifiers/relevant_domain.h"
@@ -22,19 +25,28 @@ InstStrategyEnum::InstStrategyEnum(QuantifiersState& qs,
                                    QuantifiersRegistry& qr,
                                    TermRegistry& tr,
                                    RelevantDomain* rd)
-    : QuantifiersModule(qs, qim, qr, tr), d_rd(rd), d_fullSaturateLimit(-1)
+    : QuantifiersModule(qs, qim, qr, tr),
+      d_rd(rd),
+      d_fullSaturateLimit(-1),
+      d_groundTerms(qs, tr.getTermDatabase(), &d_tteGlobalContext)
 {
   d_tteGlobalContext.d_treg = &d_treg;
+  if (options::tcpModel())
+  {
+    d_tcpPredictor.reset(new TCPPredictor(
+        &TCPClient::s_client, TermFeatureProperties::s_features.count()));
+  }
   d_tteGlobalContext.d_ml =
-      options::lightGBModel.wasSetByUser() ? static_cast<PredictorInterface*>(
-          new LightGBMWrapper(options::lightGBModel().c_str()))
-      : options::sigmoidModel.wasSetByUser() ? static_cast<PredictorInterface*>(
-            new Sigmoid(options::sigmoidModel().c_str()))
-                                             : nullptr;
+      options::lightGBModel.wasSetByUser()
+          ? PredictorCache::s_cache.getLightGBM(options::lightGBModel(),
+                                                options::lightGBNative())
+      : options::sigmoidModel.wasSetByUser()
+          ? PredictorCache::s_cache.getSigmoid(options::sigmoidModel())
+          : d_tcpPredictor.get();
   d_tteGlobalContext.d_tuplePredictor =
       (options::lightGBModelTuples.wasSetByUser())
-          ? static_cast<PredictorInterface*>(
-              new LightGBMWrapper(options::lightGBModelTuples().c_str()))
+          ? PredictorCache::s_cache.getLightGBM(options::lightGBModelTuples(),
+                                                options::lightGBNative())
           : nullptr;
   if (d_tteGlobalContext.d_ml)
   {
@@ -44,6 +56,27 @@ InstStrategyEnum::InstStrategyEnum(QuantifiersState& qs,
   }
   AlwaysAssert(!options::fullSaturateAStar() || d_tteGlobalContext.d_ml)
       << "A* cannot be run without machine learning." << std::endl;
+  // let the logger reuse the features calculated during the enumeration
+  QuantifierLogger::s_logger.setFeatureCache(
+      &d_tteGlobalContext.d_featureCache);
+  if (!options::fsProfile().empty())
+  {
+    d_profiler.reset(new InstProfiler(options::fsProfile()));
+    d_tteGlobalContext.d_profile = true;
+  }
+}
+
+InstStrategyEnum::~InstStrategyEnum()
+{
+  if (QuantifierLogger::s_logger.getFeatureCache()
+      == &d_tteGlobalContext.d_featureCache)
+  {
+    QuantifierLogger::s_logger.setFeatureCache(nullptr);
+  }
+  if (d_profiler != nullptr)
+  {
+    d_profiler->write();
+  }
 }
 
 void InstStrategyEnum::presolve()
@@ -74,7 +107,11 @@ bool InstStrategyEnum::needsCheck(Theory::Effort e)
   return false;
 }
 
-void InstStrategyEnum::reset_round(Theory::Effort e) {}
+void InstStrategyEnum::reset_round(Theory::Effort e)
+{
+  // equivalence classes may have changed since the last round
+  d_groundTerms.clear();
+}
 void InstStrategyEnum::check(Theory::Effort e, QEffort quant_e)
 {
   bool doCheck = false;
@@ -100,6 +137,10 @@ void InstStrategyEnum::check(Theory::Effort e, QEffort quant_e)
     return;
   }
   Assert(!d_qstate.isInConflict());
+  d_tteGlobalContext.d_round++;
+  const size_t cacheRounds = std::max(options::mlCacheRounds(), 0);
+  d_tteGlobalContext.d_featureCache.nextRound(cacheRounds);
+  d_tteGlobalContext.prunePredictionCache(cacheRounds);
   double clSet = 0;
   if (Trace.isOn("fs-engine"))
   {
@@ -143,15 +184,61 @@ void InstStrategyEnum::check(Theory::Effort e, QEffort quant_e)
       {
         Trace("inst-alg") << "-> Ground term instantiate..." << std::endl;
       }
+      const auto shouldProcess = [&](Node q) {
+        return d_qreg.hasOwnership(q, this) && fm->isQuantifierActive(q)
+               && alreadyProc.find(q) == alreadyProc.end();
+      };
+      // with --ml-threads=N for N > 1, the enumerations of all quantified
+      // formulas are prepared first, so that their terms are scored together
+      const bool prefetch =
+          options::mlThreads() > 1 && d_tteGlobalContext.d_ml != nullptr;
+      std::vector<std::unique_ptr<Enumeration>> enumerations(
+          prefetch ? nquant : 0);
+      if (prefetch)
+      {
+        std::vector<MLProducer*> producers;
+        for (unsigned i = 0; i < nquant; i++)
+        {
+          Node q = fm->getAssertedQuantifier(i, true);
+          if (!shouldProcess(q))
+          {
+            continue;
+          }
+          enumerations[i] = mkEnumeration(q, fullEffort, r == 0);
+          Enumeration* enumeration = enumerations[i].get();
+          if (enumeration != nullptr)
+          {
+            prepare(*enumeration);
+            if (enumeration->d_prepared)
+            {
+              producers.push_back(enumeration->d_termProducerML.get());
+            }
+          }
+        }
+        MLProducer::predictAll(producers, options::mlThreads());
+      }
+      Instantiate* ie = d_qim.getInstantiate();
+      if (options::fullSaturateBatch())
+      {
+        ie->deferInstantiations();
+      }
       for (unsigned i = 0; i < nquant; i++)
       {
         Node q = fm->getAssertedQuantifier(i, true);
-        bool doProcess = d_qreg.hasOwnership(q, this)
-                         && fm->isQuantifierActive(q)
-                         && alreadyProc.find(q) == alreadyProc.end();
+        bool doProcess = shouldProcess(q);
         if (doProcess)
         {
-          if (process(q, fullEffort, r == 0))
+          bool added = false;
+          if (!prefetch)
+          {
+            added = process(q, fullEffort, r == 0);
+          }
+          else if (enumerations[i] != nullptr)
+          {
+            added = process(q, *enumerations[i]);
+            enumerations[i].reset();
+          }
+          if (added)
           {
             // don't need to mark this if we are not stratifying
             if (!options::fullSaturateStratify())
@@ -167,6 +254,18 @@ void InstStrategyEnum::check(Theory::Effort e, QEffort quant_e)
           }
         }
       }
+      // the quantified formulas not processed because of a conflict must not
+      // have registered their candidates, as without prefetching
+      for (std::unique_ptr<Enumeration>& enumeration : enumerations)
+      {
+        if (enumeration != nullptr)
+        {
+          enumeration->d_enumerator->cancel();
+        }
+      }
+      // the quantified formulas whose lemma turns out to be a duplicate are
+      // still marked as processed
+      addedLemmas -= ie->flushInstantiations();
       if (d_qstate.isInConflict()
           || (addedLemmas > 0 && options::fullSaturateStratify()))
       {
@@ -176,6 +275,10 @@ void InstStrategyEnum::check(Theory::Effort e, QEffort quant_e)
       }
     }
   }
+  if (d_profiler != nullptr)
+  {
+    d_profiler->flush();
+  }
   if (Trace.isOn("fs-engine"))
   {
     Trace("fs-engine") << "Added lemmas = " << addedLemmas << std::endl;
@@ -190,55 +293,120 @@ void InstStrategyEnum::check(Theory::Effort e, QEffort quant_e)
 }
 
 bool InstStrategyEnum::process(Node quantifier, bool fullEffort, bool isRd)
+{
+  std::unique_ptr<Enumeration> enumeration =
+      mkEnumeration(quantifier, fullEffort, isRd);
+  if (enumeration == nullptr)
+  {
+    return false;
+  }
+  prepare(*enumeration);
+  return process(quantifier, *enumeration);
+}
+
+void InstStrategyEnum::prepare(Enumeration& enumeration)
+{
+  InstProfiler::Timer profileTimer(
+      d_profiler != nullptr ? &enumeration.d_prepareTime : nullptr);
+  enumeration.d_prepared = enumeration.d_enumerator->prepare();
+}
+
+std::unique_ptr<InstStrategyEnum::Enumeration> InstStrategyEnum::mkEnumeration(
+    Node quantifier, bool fullEffort, bool isRd)
 {
   // ignore if constant true (rare case of non-standard quantifier whose body
   // is rewritten to true)
   if (quantifier[1].isConst() && quantifier[1].getConst<bool>())
   {
-    return false;
+    return nullptr;
   }
 
-  TermTupleEnumeratorEnv ttec;
+  std::unique_ptr<Enumeration> enumeration(new Enumeration());
+  enumeration->d_isRd = isRd;
+  TermTupleEnumeratorEnv& ttec = enumeration->d_env;
   ttec.d_fullEffort = fullEffort;
   ttec.d_rd = d_rd;
   ttec.d_increaseSum = options::fullSaturateSum();
-  std::unique_ptr<ITermProducer> termProducerInner(
+  enumeration->d_termProducerInner.reset(
       isRd ? mkTermProducerRd(quantifier, d_rd)
-           : mkTermProducer(quantifier, d_qstate, d_treg.getTermDatabase()));
-  std::unique_ptr<MLProducer> termProducerML;
-  std::unique_ptr<ITermProducer> termProducerRandom;
-  ttec.d_termProducer = termProducerInner.get();
+           : mkTermProducer(quantifier, &d_groundTerms));
+  ttec.d_termProducer = enumeration->d_termProducerInner.get();
   if (d_tteGlobalContext.d_ml != nullptr)
   {  // decorate  term production by learning
-    termProducerML.reset(mkTermProducerML(
+    enumeration->d_termProducerML.reset(mkTermProducerML(
         &d_tteGlobalContext, &ttec, ttec.d_termProducer, quantifier));
-    ttec.d_termProducer = termProducerML.get();
+    ttec.d_termProducer = enumeration->d_termProducerML.get();
   }
   if (options::fullSaturateRndProbability.wasSetByUser())
   {  // decorate term production by randomization
-    termProducerRandom.reset(mkTermProducerRandomize(
+    enumeration->d_termProducerRandom.reset(mkTermProducerRandomize(
         ttec.d_termProducer, &(d_tteGlobalContext.d_mt)));
-    ttec.d_termProducer = termProducerRandom.get();
+    ttec.d_termProducer = enumeration->d_termProducerRandom.get();
   }
   const auto run_astar =
       options::fullSaturateAStar() || d_tteGlobalContext.d_tuplePredictor;
-  std::unique_ptr<TermTupleEnumeratorInterface> enumerator(
+  enumeration->d_enumerator.reset(
       run_astar ? mkAStarTermTupleEnumerator(
-          quantifier, &d_tteGlobalContext, &ttec, termProducerML.get())
+          quantifier,
+          &d_tteGlobalContext,
+          &ttec,
+          enumeration->d_termProducerML.get())
                 : mkStagedTermTupleEnumerator(
                     quantifier, &d_tteGlobalContext, &ttec));
+  return enumeration;
+}
+
+bool InstStrategyEnum::process(Node quantifier, Enumeration& enumeration)
+{
+  TermTupleEnumeratorInterface* enumerator = enumeration.d_enumerator.get();
+  // the record of this call in the profile, the times of the enumerator are
+  // only measured if it is not null
+  InstProfiler::Record* record = nullptr;
+  double* enumerateTime = nullptr;
+  if (d_profiler != nullptr)
+  {
+    record = &d_profiler->add(
+        quantifier, d_tteGlobalContext.d_round, enumeration.d_isRd);
+    record->d_ml = enumeration.d_termProducerML != nullptr;
+    record->d_enumerateTime = enumeration.d_prepareTime;
+    enumerateTime = &record->d_enumerateTime;
+  }
+  if (enumeration.d_prepared)
+  {
+    enumeration.d_env.d_termProducer->initialize();
+  }
+  {
+    InstProfiler::Timer profileTimer(enumerateTime);
+    enumerator->start();
+  }
+  if (record != nullptr)
+  {
+    if (enumeration.d_termProducerML != nullptr)
+    {
+      record->d_featurizeTime = enumeration.d_termProducerML->d_featurizeTime;
+      record->d_predictTime = enumeration.d_termProducerML->d_predictTime;
+    }
+    record->d_candidates = enumerator->getCandidateCounts();
+  }
+  const auto hasNext = [&]() {
+    InstProfiler::Timer profileTimer(enumerateTime);
+    return enumerator->hasNext();
+  };
   std::vector<Node> terms;
   QuantifierLogger::NodeVector completedTerms;
   std::vector<bool> failMask;
   Instantiate* ie = d_qim.getInstantiate();
-  for (enumerator->init(); enumerator->hasNext();)
+  while (hasNext())
   {
     if (d_qstate.isInConflict())
     {
       // could be conflicting for an internal reason
       return false;
     }
-    enumerator->next(terms);
+    {
+      InstProfiler::Timer profileTimer(enumerateTime);
+      enumerator->next(terms);
+    }
     if (options::qlogging())
     {
       // complete missing terms, TODO: elsewhere?
@@ -255,9 +423,24 @@ bool InstStrategyEnum::process(Node quantifier, bool fullEffort, bool isRd)
     }
     // try instantiation
     failMask.clear();
-    /* if (ie->addInstantiation(quantifier, terms)) */
-    const bool successful = ie->addInstantiationExpFail(
-        quantifier, terms, failMask, InferenceId::QUANTIFIERS_INST_ENUM);
+    bool successful;
+    {
+      InstProfiler::Timer profileTimer(
+          record != nullptr ? &record->d_instantiateTime : nullptr);
+      /* if (ie->addInstantiation(quantifier, terms)) */
+      successful = ie->addInstantiationExpFail(
+          quantifier, terms, failMask, InferenceId::QUANTIFIERS_INST_ENUM);
+    }
+    if (record != nullptr)
+    {
+      record->d_tuples++;
+      if (successful)
+      {
+        record->d_success = true;
+        record->d_ranks = enumerator->getCurrentIndices();
+        record->d_terms = terms;
+      }
+    }
     if (options::qlogging())
     {
       QuantifierLogger::s_logger.registerInstantiation(
@@ -270,6 +453,7 @@ bool InstStrategyEnum::process(Node quantifier, bool fullEffort, bool isRd)
     }
     else
     {
+      InstProfiler::Timer profileTimer(enumerateTime);
       enumerator->failureReason(failMask);
     }
   }
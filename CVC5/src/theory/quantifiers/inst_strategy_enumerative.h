@@ -18,6 +18,8 @@
 #ifndef CVC5__INST_STRATEGY_ENUMERATIVE_H
 #define CVC5__INST_STRATEGY_ENUMERATIVE_H
 
+#include <memory>
+
 #include "theory/quantifiers/quant_module.h"
 #include "theory/quantifiers/term_tuple_enumerator.h"
 
@@ -25,6 +27,8 @@ namespace cvc5 {
 namespace theory {
 namespace quantifiers {
 
+class InstProfiler;
+class MLProducer;
 class RelevantDomain;
 
 /** Enumerative instantiation
@@ -68,13 +72,7 @@ class InstStrategyEnum : public QuantifiersModule
                    QuantifiersRegistry& qr,
                    TermRegistry& tr,
                    RelevantDomain* rd);
-  ~InstStrategyEnum()
-  {
-    if (d_tteGlobalContext.d_ml)
-    {
-      delete d_tteGlobalContext.d_ml;
-    }
-  }
+  ~InstStrategyEnum();
   /** Presolve */
   void presolve() override;
   /** Needs check. */
@@ -114,6 +112,29 @@ class InstStrategyEnum : public QuantifiersModule
    * term instantiations.
    */
   bool process(Node q, bool fullEffort, bool isRd);
+  /** The term producers and the tuple enumerator for a quantified formula. */
+  struct Enumeration
+  {
+    TermTupleEnumeratorEnv d_env;
+    std::unique_ptr<ITermProducer> d_termProducerInner;
+    std::unique_ptr<MLProducer> d_termProducerML;
+    std::unique_ptr<ITermProducer> d_termProducerRandom;
+    std::unique_ptr<TermTupleEnumeratorInterface> d_enumerator;
+    /** the result of TermTupleEnumeratorInterface::prepare */
+    bool d_prepared = false;
+    /** whether the terms come from the relevant domain */
+    bool d_isRd = false;
+    /** time of prepare in milliseconds, measured only with --fs-profile */
+    double d_prepareTime = 0;
+  };
+  /** Make the enumeration for q as in process, null if q is trivial. */
+  std::unique_ptr<Enumeration> mkEnumeration(Node q,
+                                             bool fullEffort,
+                                             bool isRd);
+  /** Call prepare of the enumerator of enumeration. */
+  void prepare(Enumeration& enumeration);
+  /** Process q by an enumeration that has been prepared. */
+  bool process(Node q, Enumeration& enumeration);
   /**
    * A limit on the number of rounds to apply this strategy, where a value < 0
    * means no limit. This value is set to the value of fullSaturateLimit()
@@ -122,6 +143,14 @@ class InstStrategyEnum : public QuantifiersModule
   int32_t d_fullSaturateLimit;
 
   TermTupleEnumeratorGlobal d_tteGlobalContext;
+  /** the predictor of --tcp-model, other predictors are owned by
+   * PredictorCache */
+  std::unique_ptr<PredictorInterface> d_tcpPredictor;
+  /** ground terms of each type shared by the quantifiers, valid for the
+   * current round only */
+  GroundTermCache d_groundTerms;
+  /** the profile of --fs-profile, null if not requested */
+  std::unique_ptr<InstProfiler> d_profiler;
 }; /* class InstStrategyEnum */
 
 }  // namespace quantifiers
@@ -53,6 +53,7 @@ Instantiate::Instantiate(QuantifiersState& qs,
       d_treg(tr),
       d_pnm(pnm),
       d_insts(qs.getUserContext()),
+      d_deferring(false),
       d_c_inst_match_trie_dom(qs.getUserContext()),
       d_pfInst(pnm ? new CDProof(pnm) : nullptr)
 {
@@ -72,6 +73,12 @@ bool Instantiate::reset(Theory::Effort e)
   Trace("inst-debug") << "Reset, effort " << e << std::endl;
   // clear explicitly recorded instantiations
   d_recordedInst.clear();
+  // send the lemmas left deferred by an interrupted round
+  if (!d_deferred.empty())
+  {
+    flushInstantiations();
+  }
+  d_deferring = false;
   return true;
 }
 
@@ -231,6 +238,12 @@ bool Instantiate::addInstantiation(Node q,
     ++(d_statistics.d_inst_duplicate_eq);
     return false;
   }
+  if (d_deferring)
+  {
+    Trace("inst-add-debug") << " --> Deferred." << std::endl;
+    d_deferred.push_back(DeferredInstantiation{q, terms, id, doVts});
+    return true;
+  }
 
   // Set up a proof if proofs are enabled. This proof stores a proof of
   // the instantiation body with q as a free assumption.
@@ -245,10 +258,18 @@ bool Instantiate::addInstantiation(Node q,
   Trace("inst-add-debug") << "Constructing instantiation..." << std::endl;
   Assert(d_qreg.d_vars[q].size() == terms.size());
   // get the instantiation
-  Node body = getInstantiation(q, d_qreg.d_vars[q], terms, doVts, pfTmp.get());
+  Node body;
+  {
+    CodeTimer codeTimer(d_statistics.d_substituteTime);
+    body = getInstantiation(q, d_qreg.d_vars[q], terms, doVts, pfTmp.get());
+  }
   Node orig_body = body;
   // now preprocess, storing the trust node for the rewrite
-  TrustNode tpBody = QuantifiersRewriter::preprocess(body, true);
+  TrustNode tpBody;
+  {
+    CodeTimer codeTimer(d_statistics.d_preprocessTime);
+    tpBody = QuantifiersRewriter::preprocess(body, true);
+  }
   if (!tpBody.isNull())
   {
     Assert(tpBody.getKind() == TrustNodeKind::REWRITE);
@@ -277,6 +298,11 @@ bool Instantiate::addInstantiation(Node q,
 
   // construct the instantiation, and rewrite the lemma
   Node lem = NodeManager::currentNM()->mkNode(kind::IMPLIES, q, body);
+  Node rlem;
+  {
+    CodeTimer codeTimer(d_statistics.d_rewriteTime);
+    rlem = Rewriter::rewrite(lem);
+  }
 
   // If proofs are enabled, construct the proof, which is of the form:
   // ... free assumption q ...
@@ -298,20 +324,16 @@ bool Instantiate::addInstantiation(Node q,
     Assert(assumps.size() == 1 && assumps[0] == q);
     // store in the main proof
     d_pfInst->addProof(pfns);
-    Node prevLem = lem;
-    lem = Rewriter::rewrite(lem);
-    if (prevLem != lem)
+    if (rlem != lem)
     {
-      d_pfInst->addStep(lem, PfRule::MACRO_SR_PRED_ELIM, {prevLem}, {});
+      d_pfInst->addStep(rlem, PfRule::MACRO_SR_PRED_ELIM, {lem}, {});
     }
     hasProof = true;
   }
-  else
-  {
-    lem = Rewriter::rewrite(lem);
-  }
+  lem = rlem;
 
   // added lemma, which checks for lemma duplication
+  CodeTimer codeTimer(d_statistics.d_dispatchTime);
   bool addedLem = false;
   if (hasProof)
   {
@@ -331,7 +353,17 @@ bool Instantiate::addInstantiation(Node q,
     return false;
   }
   Trace("inst-add-debug") << " --> Lemma added: " << lem << std::endl;
+  notifyInstantiationLemma(q, terms, body, orig_body, lem, doVts);
+  return true;
+}
 
+void Instantiate::notifyInstantiationLemma(Node q,
+                                           std::vector<Node>& terms,
+                                           Node body,
+                                           Node origBody,
+                                           Node lem,
+                                           bool doVts)
+{
   // add to list of instantiations
   InstLemmaList* ill = getOrMkInstLemmaList(q);
   ill->d_list.push_back(body);
@@ -382,13 +414,73 @@ bool Instantiate::addInstantiation(Node q,
         }
       }
       QuantAttributes::setInstantiationLevelAttr(
-          orig_body, q[1], maxInstLevel + 1);
+          origBody, q[1], maxInstLevel + 1);
     }
   }
   d_treg.processInstantiation(q, terms);
   Trace("inst-add-debug") << " --> Success." << std::endl;
   ++(d_statistics.d_instantiations);
-  return true;
+}
+
+void Instantiate::deferInstantiations()
+{
+  d_deferring = !isProofEnabled() && !options::qlogging();
+}
+
+size_t Instantiate::flushInstantiations()
+{
+  d_deferring = false;
+  std::vector<DeferredInstantiation> deferred;
+  deferred.swap(d_deferred);
+  const size_t size = deferred.size();
+  Trace("inst-add-debug") << "Flush " << size << " deferred instantiations"
+                          << std::endl;
+  // do each stage for all instantiations, so that the rewriter works on the
+  // similar bodies of a round one after the other
+  std::vector<Node> origBodies(size), bodies(size), lemmas(size);
+  {
+    CodeTimer codeTimer(d_statistics.d_substituteTime);
+    for (size_t i = 0; i < size; i++)
+    {
+      DeferredInstantiation& d = deferred[i];
+      origBodies[i] = getInstantiation(
+          d.d_q, d_qreg.d_vars[d.d_q], d.d_terms, d.d_doVts);
+    }
+  }
+  {
+    CodeTimer codeTimer(d_statistics.d_preprocessTime);
+    for (size_t i = 0; i < size; i++)
+    {
+      TrustNode tpBody = QuantifiersRewriter::preprocess(origBodies[i], true);
+      bodies[i] = tpBody.isNull() ? origBodies[i] : tpBody.getNode();
+    }
+  }
+  {
+    CodeTimer codeTimer(d_statistics.d_rewriteTime);
+    NodeManager* nm = NodeManager::currentNM();
+    for (size_t i = 0; i < size; i++)
+    {
+      lemmas[i] = Rewriter::rewrite(
+          nm->mkNode(kind::IMPLIES, deferred[i].d_q, bodies[i]));
+    }
+  }
+  CodeTimer codeTimer(d_statistics.d_dispatchTime);
+  size_t duplicates = 0;
+  for (size_t i = 0; i < size; i++)
+  {
+    DeferredInstantiation& d = deferred[i];
+    if (!d_qim.addPendingLemma(lemmas[i], d.d_id))
+    {
+      Trace("inst-add-debug") << " --> Lemma already exists." << std::endl;
+      ++(d_statistics.d_inst_duplicate);
+      duplicates++;
+      continue;
+    }
+    Trace("inst-add-debug") << " --> Lemma added: " << lemmas[i] << std::endl;
+    notifyInstantiationLemma(
+        d.d_q, d.d_terms, bodies[i], origBodies[i], lemmas[i], d.d_doVts);
+  }
+  return duplicates;
 }
 
 bool Instantiate::addInstantiationExpFail(Node q,
@@ -421,8 +513,32 @@ bool Instantiate::addInstantiationExpFail(Node q,
   {
     subs[vars[i]] = terms[i];
   }
-  // get the instantiation body
-  Node ibody = getInstantiation(q, vars, terms, doVts);
+  // The instantiation bodies below differ from each other only in the
+  // subterms containing the reverted variable, so only these are substituted
+  // anew, current holds the substitution of the other subterms of q[1]. The
+  // rewriter caches the rewrites of the unchanged subterms.
+  const VariableOccurrences& occ = getVariableOccurrences(q);
+  std::unordered_map<TNode, Node, TNodeHashFunction> ownCurrent, changed;
+  // get the instantiation body, with the substitution cache of q if enabled,
+  // which then follows the reverted variables below
+  SubstitutionCache* sc = nullptr;
+  Node ibody;
+  if (options::instSubstCache())
+  {
+    ibody = substituteIncremental(q, terms);
+    sc = &d_substCache[q];
+  }
+  else
+  {
+    ibody =
+        substituteBody(q[1], occ.d_withVariables, occ, terms, {}, ownCurrent);
+  }
+  std::unordered_map<TNode, Node, TNodeHashFunction>& current =
+      sc != nullptr ? sc->d_substituted : ownCurrent;
+  Assert(ibody
+         == q[1].substitute(
+             vars.begin(), vars.end(), terms.begin(), terms.end()));
+  ibody = rewriteInstantiationBody(q, terms, ibody, doVts, nullptr);
   ibody = Rewriter::rewrite(ibody);
   for (size_t i = 0; i < tsize; i++)
   {
@@ -439,6 +555,14 @@ bool Instantiate::addInstantiationExpFail(Node q,
       break;
     }
     Trace("inst-exp-fail") << "- revert " << ii << std::endl;
+    const auto& affected = occ.d_containing[ii];
+    if (affected.empty() && d_instRewrite.empty())
+    {
+      // the variable does not occur in the body, which is hence unchanged
+      Trace("inst-exp-fail") << "  does not occur" << std::endl;
+      failMask[ii] = false;
+      continue;
+    }
     // check whether we are still redundant
     bool success = false;
     // check entailment, only if option is set
@@ -448,10 +572,15 @@ bool Instantiate::addInstantiationExpFail(Node q,
       success = tdb->isEntailed(q[1], subs, false, true);
       Trace("inst-exp-fail") << "  entailed: " << success << std::endl;
     }
+    changed.clear();
+    Node ibodyc = substituteBody(q[1], affected, occ, terms, current, changed);
+    Assert(ibodyc
+           == q[1].substitute(
+               vars.begin(), vars.end(), terms.begin(), terms.end()));
     // check whether the instantiation rewrites to the same thing
     if (!success)
     {
-      Node ibodyc = getInstantiation(q, vars, terms, doVts);
+      ibodyc = rewriteInstantiationBody(q, terms, ibodyc, doVts, nullptr);
       ibodyc = Rewriter::rewrite(ibodyc);
       success = (ibodyc == ibody);
       Trace("inst-exp-fail") << "  rewrite invariant: " << success << std::endl;
@@ -460,6 +589,14 @@ bool Instantiate::addInstantiationExpFail(Node q,
     {
       // if we still fail, we are not critical
       failMask[ii] = false;
+      for (std::pair<const TNode, Node>& c : changed)
+      {
+        current[c.first] = c.second;
+      }
+      if (sc != nullptr)
+      {
+        sc->d_terms[ii] = vars[ii];
+      }
     }
     else
     {
@@ -527,17 +664,38 @@ Node Instantiate::getInstantiation(Node q,
 {
   Assert(vars.size() == terms.size());
   Assert(q[0].getNumChildren() == vars.size());
-  // Notice that this could be optimized, but no significant performance
-  // improvements were observed with alternative implementations (see #1386).
-  Node body =
-      q[1].substitute(vars.begin(), vars.end(), terms.begin(), terms.end());
+  Node body;
+  std::map<Node, std::vector<Node>>::const_iterator itv;
+  if (options::instSubstCache()
+      && (itv = d_qreg.d_vars.find(q)) != d_qreg.d_vars.end()
+      && itv->second == vars)
+  {
+    // consecutive instantiations of q usually differ in few terms
+    body = substituteIncremental(q, terms);
+    Assert(body
+           == q[1].substitute(
+               vars.begin(), vars.end(), terms.begin(), terms.end()));
+  }
+  else
+  {
+    body =
+        q[1].substitute(vars.begin(), vars.end(), terms.begin(), terms.end());
+  }
 
   // store the proof of the instantiated body, with (open) assumption q
   if (pf != nullptr)
   {
     pf->addStep(body, PfRule::INSTANTIATE, {q}, terms);
   }
+  return rewriteInstantiationBody(q, terms, body, doVts, pf);
+}
 
+Node Instantiate::rewriteInstantiationBody(Node q,
+                                           std::vector<Node>& terms,
+                                           Node body,
+                                           bool doVts,
+                                           LazyCDProof* pf)
+{
   // run rewriters to rewrite the instantiation in sequence.
   for (InstantiationRewriter*& ir : d_instRewrite)
   {
@@ -568,6 +726,176 @@ Node Instantiate::getInstantiation(Node q, std::vector<Node>& terms, bool doVts)
   return getInstantiation(q, d_qreg.d_vars[q], terms, doVts);
 }
 
+const Instantiate::VariableOccurrences& Instantiate::getVariableOccurrences(
+    Node q)
+{
+  std::map<Node, VariableOccurrences>::iterator it = d_varOccurrences.find(q);
+  if (it != d_varOccurrences.end())
+  {
+    return it->second;
+  }
+  VariableOccurrences& occ = d_varOccurrences[q];
+  const std::vector<Node>& vars = d_qreg.d_vars[q];
+  occ.d_containing.resize(vars.size());
+  for (size_t i = 0, size = vars.size(); i < size; i++)
+  {
+    occ.d_index[vars[i]] = i;
+  }
+  // the indices of the variables in each subterm, computed in post-order
+  std::unordered_map<TNode, std::vector<size_t>, TNodeHashFunction> varsOf;
+  std::vector<std::pair<TNode, bool>> toVisit{{q[1], false}};
+  while (!toVisit.empty())
+  {
+    const auto [n, childrenDone] = toVisit.back();
+    toVisit.pop_back();
+    if (varsOf.find(n) != varsOf.end())
+    {
+      continue;
+    }
+    const bool parameterized =
+        n.getMetaKind() == kind::metakind::PARAMETERIZED;
+    if (!childrenDone)
+    {
+      toVisit.emplace_back(n, true);
+      if (parameterized)
+      {
+        toVisit.emplace_back(n.getOperator(), false);
+      }
+      for (TNode child : n)
+      {
+        toVisit.emplace_back(child, false);
+      }
+      continue;
+    }
+    std::vector<size_t> nvars;
+    std::unordered_map<TNode, size_t, TNodeHashFunction>::const_iterator itv =
+        occ.d_index.find(n);
+    if (itv != occ.d_index.end())
+    {
+      nvars.push_back(itv->second);
+    }
+    if (parameterized)
+    {
+      const std::vector<size_t>& opVars = varsOf[n.getOperator()];
+      nvars.insert(nvars.end(), opVars.begin(), opVars.end());
+    }
+    for (TNode child : n)
+    {
+      const std::vector<size_t>& childVars = varsOf[child];
+      nvars.insert(nvars.end(), childVars.begin(), childVars.end());
+    }
+    std::sort(nvars.begin(), nvars.end());
+    nvars.erase(std::unique(nvars.begin(), nvars.end()), nvars.end());
+    for (size_t v : nvars)
+    {
+      occ.d_containing[v].insert(n);
+    }
+    if (!nvars.empty())
+    {
+      occ.d_withVariables.insert(n);
+    }
+    varsOf[n] = std::move(nvars);
+  }
+  return occ;
+}
+
+Node Instantiate::substituteBody(
+    TNode n,
+    const std::unordered_set<TNode, TNodeHashFunction>& affected,
+    const VariableOccurrences& occ,
+    const std::vector<Node>& terms,
+    const std::unordered_map<TNode, Node, TNodeHashFunction>& previous,
+    std::unordered_map<TNode, Node, TNodeHashFunction>& visited)
+{
+  if (affected.find(n) == affected.end())
+  {
+    std::unordered_map<TNode, Node, TNodeHashFunction>::const_iterator it =
+        previous.find(n);
+    return it == previous.end() ? Node(n) : it->second;
+  }
+  std::unordered_map<TNode, Node, TNodeHashFunction>::iterator it =
+      visited.find(n);
+  if (it != visited.end())
+  {
+    return it->second;
+  }
+  Node result;
+  std::unordered_map<TNode, size_t, TNodeHashFunction>::const_iterator itv =
+      occ.d_index.find(n);
+  if (itv != occ.d_index.end())
+  {
+    result = terms[itv->second];
+  }
+  else
+  {
+    // as in Node::substitute
+    Assert(n.getNumChildren() > 0);
+    NodeBuilder nb(n.getKind());
+    if (n.getMetaKind() == kind::metakind::PARAMETERIZED)
+    {
+      nb << substituteBody(
+          n.getOperator(), affected, occ, terms, previous, visited);
+    }
+    for (TNode child : n)
+    {
+      nb << substituteBody(child, affected, occ, terms, previous, visited);
+    }
+    result = nb;
+  }
+  visited[n] = result;
+  return result;
+}
+
+Node Instantiate::substituteIncremental(Node q, const std::vector<Node>& terms)
+{
+  const VariableOccurrences& occ = getVariableOccurrences(q);
+  SubstitutionCache& sc = d_substCache[q];
+  if (sc.d_terms.empty())
+  {
+    sc.d_terms = terms;
+    return substituteBody(
+        q[1], occ.d_withVariables, occ, terms, {}, sc.d_substituted);
+  }
+  Assert(sc.d_terms.size() == terms.size());
+  std::vector<size_t> changedVars;
+  for (size_t i = 0, size = terms.size(); i < size; i++)
+  {
+    if (terms[i] != sc.d_terms[i])
+    {
+      changedVars.push_back(i);
+    }
+  }
+  std::unordered_set<TNode, TNodeHashFunction> merged;
+  const std::unordered_set<TNode, TNodeHashFunction>* affected = &merged;
+  if (changedVars.size() == 1)
+  {
+    affected = &occ.d_containing[changedVars[0]];
+  }
+  else if (changedVars.size() == terms.size())
+  {
+    affected = &occ.d_withVariables;
+  }
+  else
+  {
+    for (size_t i : changedVars)
+    {
+      merged.insert(occ.d_containing[i].begin(), occ.d_containing[i].end());
+    }
+  }
+  std::unordered_map<TNode, Node, TNodeHashFunction> changed;
+  Node body =
+      substituteBody(q[1], *affected, occ, terms, sc.d_substituted, changed);
+  for (std::pair<const TNode, Node>& c : changed)
+  {
+    sc.d_substituted[c.first] = c.second;
+  }
+  for (size_t i : changedVars)
+  {
+    sc.d_terms[i] = terms[i];
+  }
+  return body;
+}
+
 bool Instantiate::recordInstantiationInternal(Node q,
                                               std::vector<Node>& terms,
                                               bool modEq)
@@ -755,7 +1083,15 @@ Instantiate::Statistics::Statistics()
       d_inst_duplicate_eq(smtStatisticsRegistry().registerInt(
           "Instantiate::Duplicate_Inst_Eq")),
       d_inst_duplicate_ent(smtStatisticsRegistry().registerInt(
-          "Instantiate::Duplicate_Inst_Entailed"))
+          "Instantiate::Duplicate_Inst_Entailed")),
+      d_substituteTime(smtStatisticsRegistry().registerTimer(
+          "Instantiate::Substitute_Time")),
+      d_preprocessTime(smtStatisticsRegistry().registerTimer(
+          "Instantiate::Preprocess_Time")),
+      d_rewriteTime(smtStatisticsRegistry().registerTimer(
+          "Instantiate::Rewrite_Time")),
+      d_dispatchTime(smtStatisticsRegistry().registerTimer(
+          "Instantiate::Dispatch_Time"))
 {
 }
 
@@ -19,6 +19,8 @@
 #define CVC5__THEORY__QUANTIFIERS__INSTANTIATE_H
 
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "context/cdhashset.h"
 #include "expr/node.h"
@@ -196,6 +198,23 @@ class Instantiate : public QuantifiersUtil
                                bool modEq = false,
                                bool doVts = false,
                                bool expFull = true);
+  /** defer instantiations
+   *
+   * From now on until the next call to flushInstantiations, addInstantiation
+   * stops after checking and recording the instantiation in the
+   * instantiation tries, and returns true. The lemmas of these instantiations
+   * are constructed by flushInstantiations, which does each stage for all of
+   * them in turn, and may then find some lemmas to be duplicates, see (5)
+   * above. This has no effect if proofs or quantifier logging are enabled,
+   * which need the lemma of each instantiation as soon as it is added.
+   */
+  void deferInstantiations();
+  /**
+   * Construct and send the lemmas of the deferred instantiations, and stop
+   * deferring. Returns the number of these instantiations that failed since
+   * their lemma was a duplicate, after addInstantiation returned true.
+   */
+  size_t flushInstantiations();
   /** record instantiation
    *
    * Explicitly record that q has been instantiated with terms, with virtual
@@ -289,11 +308,79 @@ class Instantiate : public QuantifiersUtil
     IntStat d_inst_duplicate;
     IntStat d_inst_duplicate_eq;
     IntStat d_inst_duplicate_ent;
+    /** time spent in the stages of making instantiation lemmas */
+    TimerStat d_substituteTime;
+    TimerStat d_preprocessTime;
+    TimerStat d_rewriteTime;
+    TimerStat d_dispatchTime;
     Statistics();
   }; /* class Instantiate::Statistics */
   Statistics d_statistics;
 
  private:
+  /** The subterms of the body of a quantified formula containing each of its
+   * variables, used for explaining failed instantiations. */
+  struct VariableOccurrences
+  {
+    /** the index of each variable */
+    std::unordered_map<TNode, size_t, TNodeHashFunction> d_index;
+    /** for each variable, the subterms of the body containing it, including
+     * the operators of parameterized terms */
+    std::vector<std::unordered_set<TNode, TNodeHashFunction>> d_containing;
+    /** the subterms of the body containing any variable */
+    std::unordered_set<TNode, TNodeHashFunction> d_withVariables;
+  };
+  /** Get the variable occurrences of the body of q, computed on demand. */
+  const VariableOccurrences& getVariableOccurrences(Node q);
+  /** The last substitution of the body of a quantified formula. */
+  struct SubstitutionCache
+  {
+    /** the terms of the substitution, empty if none was made yet */
+    std::vector<Node> d_terms;
+    /** the substitution of each subterm of the body containing variables */
+    std::unordered_map<TNode, Node, TNodeHashFunction> d_substituted;
+  };
+  /** Substitute the variables of q by terms in its body, starting from the
+   * last substitution of q, which is then updated to terms. Only the
+   * subterms containing the variables whose terms changed are substituted
+   * anew. */
+  Node substituteIncremental(Node q, const std::vector<Node>& terms);
+  /** Substitute the variables of a quantified formula in n, a subterm of its
+   * body, by terms. Only the subterms in affected are substituted anew and
+   * recorded in visited, the others are looked up in previous, where they
+   * are left unchanged if absent. The result is the same as the one of
+   * Node::substitute, provided that previous contains the substitutions of
+   * the unaffected subterms containing variables. */
+  static Node substituteBody(
+      TNode n,
+      const std::unordered_set<TNode, TNodeHashFunction>& affected,
+      const VariableOccurrences& occ,
+      const std::vector<Node>& terms,
+      const std::unordered_map<TNode, Node, TNodeHashFunction>& previous,
+      std::unordered_map<TNode, Node, TNodeHashFunction>& visited);
+  /** An instantiation whose lemma is deferred, see deferInstantiations. */
+  struct DeferredInstantiation
+  {
+    Node d_q;
+    std::vector<Node> d_terms;
+    InferenceId d_id;
+    bool d_doVts;
+  };
+  /** Notify that the instantiation lemma lem of q for terms was sent, where
+   * origBody is the instantiated body before and body after preprocessing. */
+  void notifyInstantiationLemma(Node q,
+                                std::vector<Node>& terms,
+                                Node body,
+                                Node origBody,
+                                Node lem,
+                                bool doVts);
+  /** Run the instantiation rewriters on body, the instantiation of q for
+   * terms, see getInstantiation. */
+  Node rewriteInstantiationBody(Node q,
+                                std::vector<Node>& terms,
+                                Node body,
+                                bool doVts,
+                                LazyCDProof* pf);
   /** record instantiation, return true if it was not a duplicate
    *
    * modEq : whether to check for duplication modulo equality in instantiation
@@ -340,6 +427,16 @@ class Instantiate : public QuantifiersUtil
   std::map<Node, std::vector<Node> > d_recordedInst;
   /** statistics for debugging total instantiations per quantifier per round */
   std::map<Node, uint32_t> d_temp_inst_debug;
+  /** variable occurrences for each quantified formula whose failed
+   * instantiations were explained */
+  std::map<Node, VariableOccurrences> d_varOccurrences;
+  /** whether lemmas are deferred, see deferInstantiations */
+  bool d_deferring;
+  /** the deferred instantiations, in the order they were added */
+  std::vector<DeferredInstantiation> d_deferred;
+  /** the last substitution for each quantified formula, if
+   * options::instSubstCache() */
+  std::map<Node, SubstitutionCache> d_substCache;
 
   /** list of all instantiations produced for each quantifier
    *
@@ -1,8 +1,21 @@
 
 #include "theory/quantifiers/ml.h"
 
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <cctype>
+#include <cerrno>
+#include <chrono>
 #include <climits>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -25,8 +38,78 @@
 #include "smt/node_command.h"
 #include "smt/smt_engine.h"
 #include "smt_util/boolean_simplification.h"
+#include "theory/quantifiers/tree_ensemble.h"
 
 namespace cvc5 {
+bool PredictorInterface::predictBatchCSR(const int32_t* rowStarts,
+                                         const int32_t* indices,
+                                         const float* values,
+                                         size_t rowCount,
+                                         double* out)
+{
+  const size_t featureCount = numberOfFeatures();
+  std::vector<float> row(featureCount, 0);
+  for (size_t i = 0; i < rowCount; i++)
+  {
+    for (int32_t j = rowStarts[i]; j < rowStarts[i + 1]; j++)
+    {
+      if (static_cast<size_t>(indices[j]) < featureCount)
+      {
+        row[indices[j]] = values[j];
+      }
+    }
+    out[i] = predict(row.data());
+    for (int32_t j = rowStarts[i]; j < rowStarts[i + 1]; j++)
+    {
+      if (static_cast<size_t>(indices[j]) < featureCount)
+      {
+        row[indices[j]] = 0;
+      }
+    }
+  }
+  return true;
+}
+
+PredictorInterface* mkLightGBMPredictor(const char* modelFile, bool native)
+{
+#ifdef CVC5_USE_LIGHTGBM
+  if (!native)
+  {
+    return new LightGBMWrapper(modelFile);
+  }
+#endif
+  return new TreeEnsemble(modelFile);
+}
+
+PredictorCache PredictorCache::s_cache;
+
+PredictorInterface* PredictorCache::getLightGBM(const std::string& modelFile,
+                                                bool native)
+{
+  std::unique_ptr<PredictorInterface>& predictor =
+      d_predictors[{native ? "native" : "lightgbm", modelFile}];
+  if (!predictor)
+  {
+    predictor.reset(mkLightGBMPredictor(modelFile.c_str(), native));
+  }
+  return predictor.get();
+}
+
+PredictorInterface* PredictorCache::getSigmoid(const std::string& modelFile)
+{
+  std::unique_ptr<PredictorInterface>& predictor =
+      d_predictors[{"sigmoid", modelFile}];
+  if (!predictor)
+  {
+    predictor.reset(new Sigmoid(modelFile.c_str()));
+  }
+  return predictor.get();
+}
+
+#ifdef CVC5_USE_LIGHTGBM
+/** Prediction parameters passed to LightGBM. */
+static const char* s_lgbmParameters = "early_stopping_rounds=100";
+
 LightGBMWrapper::LightGBMWrapper(const char* modelFile)
 {
   const int ec =
@@ -34,6 +117,10 @@ LightGBMWrapper::LightGBMWrapper(const char* modelFile)
   Trace("ml") << "Loaded LGBM model " << modelFile << " with "
               << d_numIterations << " iterations." << std::endl;
   AlwaysAssert(ec == 0);
+  int sz = -1;
+  const int ecf = LGBM_BoosterGetNumFeature(d_handle, &sz);
+  AlwaysAssert(ecf == 0 && sz >= 0);
+  d_numFeatures = sz;
 }
 
 double LightGBMWrapper::predict(const float* features)
@@ -62,7 +149,7 @@ double LightGBMWrapper::predict(const float* features)
                                          /* C_API_PREDICT_RAW_SCORE, */
                                          0,
                                          -1,
-                                         "early_stopping_rounds=100",
+                                         s_lgbmParameters,
                                          &returnSize,
                                          &returnValue);
   AlwaysAssert(ec == 0);
@@ -71,15 +158,68 @@ double LightGBMWrapper::predict(const float* features)
   return returnValue;
 }
 
-size_t LightGBMWrapper::numberOfFeatures() const
+void LightGBMWrapper::predictBatch(const float* rows,
+                                   size_t rowCount,
+                                   double* out)
 {
-  int sz = -1;
-  const int ec = LGBM_BoosterGetNumFeature(d_handle, &sz);
+  if (rowCount == 0)
+  {
+    return;
+  }
+  AlwaysAssert(rowCount <= static_cast<size_t>(INT32_MAX));
+  int64_t returnSize;
+  const int ec = LGBM_BoosterPredictForMat(d_handle,
+                                           rows,
+                                           C_API_DTYPE_FLOAT32,
+                                           rowCount,
+                                           d_numFeatures,
+                                           1,  // row major
+                                           C_API_PREDICT_NORMAL,
+                                           0,
+                                           -1,
+                                           s_lgbmParameters,
+                                           &returnSize,
+                                           out);
   AlwaysAssert(ec == 0);
-  return sz;
+  AlwaysAssert(returnSize == static_cast<int64_t>(rowCount));
+  Trace("ml") << "batch prediction of " << rowCount << " rows" << std::endl;
+}
+
+bool LightGBMWrapper::predictBatchCSR(const int32_t* rowStarts,
+                                      const int32_t* indices,
+                                      const float* values,
+                                      size_t rowCount,
+                                      double* out)
+{
+  if (rowCount == 0)
+  {
+    return true;
+  }
+  int64_t returnSize;
+  const int ec = LGBM_BoosterPredictForCSR(d_handle,
+                                           rowStarts,
+                                           C_API_DTYPE_INT32,
+                                           indices,
+                                           values,
+                                           C_API_DTYPE_FLOAT32,
+                                           rowCount + 1,
+                                           rowStarts[rowCount],
+                                           d_numFeatures,
+                                           C_API_PREDICT_NORMAL,
+                                           0,
+                                           -1,
+                                           s_lgbmParameters,
+                                           &returnSize,
+                                           out);
+  AlwaysAssert(ec == 0);
+  AlwaysAssert(returnSize == static_cast<int64_t>(rowCount));
+  Trace("ml") << "sparse batch prediction of " << rowCount << " rows"
+              << std::endl;
+  return true;
 }
 
 LightGBMWrapper::~LightGBMWrapper() {}
+#endif /* CVC5_USE_LIGHTGBM */
 
 Sigmoid::Sigmoid(const char* modelFile)
 {
@@ -89,574 +229,384 @@ Sigmoid::Sigmoid(const char* modelFile)
 }
 }  // namespace cvc5
 
-#ifndef LIB_SOCKET_H
-#define LIB_SOCKET_H
-
-#if defined(_MSC_VER)
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#else
-#include <arpa/inet.h>
-#include <errno.h>
-#include <fcntl.h>
-#include <netdb.h>  //hostent
-#include <netinet/in.h>
-#include <sys/socket.h>
-#include <sys/stat.h>
-#include <sys/types.h>
-#include <syslog.h>
-#include <unistd.h>
-#endif
-#include <assert.h>
-#include <stdio.h>
-#include <string.h>
-#include <time.h>
-
-#include <cerrno>
-#include <ctime>
-#include <iostream>
-#include <string>
-
-// multi platform socket descriptor
-#if _WIN32
-typedef SOCKET socketfd_t;
-#else
-typedef int socketfd_t;
-#endif
-
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-// utils
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-
-std::string str_extract(const std::string& str_in);
-std::string prt_time();
-int set_daemon(const char* str_dir);
-void wait(int nbr_secs);
-
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-// socket_t
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-
-class socket_t
-{
- public:
-  socket_t();
-  socket_t(socketfd_t sockfd, sockaddr_in sock_addr);
-  void close();
-  int write_all(const void* buf, int size_buf);
-  int read_all(void* buf, int size_buf);
-  int hostname_to_ip(const char* host_name, char* ip);
-
- public:
-  socketfd_t m_sockfd;        // socket descriptor
-  sockaddr_in m_sockaddr_in;  // client address (used to store return value of
-                              // server accept())
-};
-
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-// tcp_client_t
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-
-class tcp_client_t : public socket_t
-{
- public:
-  tcp_client_t();
-  ~tcp_client_t();
-  int connect();
-
-  tcp_client_t(const char* host_name, const unsigned short server_port);
-  int connect(const char* host_name, const unsigned short server_port);
-
- protected:
-  std::string m_server_ip;
-  unsigned short m_server_port;
-};
-
-#endif
-
-#ifndef LIB_NETSOCKET_JSON_MESSAGE_H
-#define LIB_NETSOCKET_JSON_MESSAGE_H
-
-/* #include "socket.hh" */
-
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-// custom TCP message:
-// a header with size in bytes and # terminator
-// JSON text
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-
-int write_request(socket_t& socket, const char* buf_msg);
-std::string read_response(socket_t& socket);
-
-#endif
-
 namespace cvc5 {
-TCPClient TCPClient::s_client;
-/* TCPClient::TCPClient() { open(); } */
-TCPClient::TCPClient() {}
-TCPClient::~TCPClient() { close(); }
-
-int TCPReader::predict(const char* message)
+TCPClient TCPClient::s_client(true);
+TCPClient TCPClient::s_learningClient(false);
+
+TCPClient::TCPClient(bool withTimeout)
+    : d_fromOptions(true),
+      d_withTimeout(withTimeout),
+      d_port(0),
+      d_timeoutMs(0),
+      d_verbosity(0)
 {
-  TCPClient::sopen();
-  const auto sec = TCPClient::send(message);
-  if (sec != 0)
-  {
-    return sec;
-  }
-  const auto rv = receive();
-  TCPClient::sclose();
-  return rv;
 }
 
-int TCPClient::open()
+TCPClient::TCPClient(const std::string& host,
+                     unsigned short port,
+                     int timeoutMs)
+    : d_fromOptions(false),
+      d_withTimeout(true),
+      d_host(host),
+      d_port(port),
+      d_timeoutMs(timeoutMs),
+      d_verbosity(0)
 {
-  d_client = std::make_unique<tcp_client_t>(d_server, d_port);
-  if (options::tcpLearningVerb())
-    std::cout << "client connecting to: " << d_server << ":" << d_port << " <"
-              << d_client->m_sockfd << "> " << std::endl;
-
-  /////////////////////////////////////////////////////////////////////////////////////////////////////
-  // create socket and open connection
-  /////////////////////////////////////////////////////////////////////////////////////////////////////
-
-  if (d_client->connect() < 0)
-  {
-    AlwaysAssert(false) << "client connection error " << std::endl;
-    return -1;
-  }
-  if (options::tcpLearningVerb())
-  {
-    std::cout << "client connected to: " << d_server << ":" << d_port << " <"
-              << d_client->m_sockfd << "> " << std::endl;
-  }
-  d_isOpen = true;
-  return 0;
 }
 
-int TCPClient::send_internal(const char* message)
-{
-  /////////////////////////////////////////////////////////////////////////////////////////////////////
-  // write request
-  /////////////////////////////////////////////////////////////////////////////////////////////////////
+TCPClient::~TCPClient() { close(); }
 
-  if (options::tcpLearningVerb())
-    std::cout << "client write request " << std::endl;
-  if (write_request(*d_client, message) < 0)
+int64_t TCPClient::deadline() const
+{
+  if (d_timeoutMs <= 0)
   {
-    AlwaysAssert(false) << "client write error " << std::endl;
     return -1;
   }
-  if (options::tcpLearningVerb() > 1)
-  {
-    std::cout << "client sent: ";
-    std::cout << message << " " << d_server << ":" << d_port << " <"
-              << d_client->m_sockfd << "> " << std::endl;
-  }
-  return 0;
+  const auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(now).count()
+         + d_timeoutMs;
 }
 
-static void skip(std::stringstream& s, char expected)
+bool TCPClient::wait(short events, int64_t deadline)
 {
-  const auto c = s.get();
-  AlwaysAssert(c == expected)
-      << c << " obtained instead of " << expected << std::endl;
-}
-
-std::string TCPClient::receive_internal()
-{
-  /////////////////////////////////////////////////////////////////////////////////////////////////////
-  // read response
-  /////////////////////////////////////////////////////////////////////////////////////////////////////
-
-  std::string str_response = read_response(*d_client);
-  if (options::tcpLearningVerb() > 1)
+  while (true)
   {
-    std::cout << "client received: ";
-    std::cout << str_response << " " << d_server << ":" << d_port << " <"
-              << d_client->m_sockfd << "> " << std::endl;
-  }
-  return str_response;
-}
-
-int TCPReader::receive()
-{
-  std::string str_response = TCPClient::receive();
-  std::stringstream input(str_response);
-  skip(input, '[');
-  bool closed = true;
-  while (!closed || input.peek() != ']')
-  {
-    AlwaysAssert(!(input.eof() || input.fail() || input.bad()))
-        << " ERROR: something went wrong in input";
-    if (isspace(input.peek()))
-    {
-      input.get();
-      continue;
-    }
-    if (closed)
+    int timeout = -1;
+    if (deadline >= 0)
     {
-      skip(input, '[');
-      if (options::tcpLearningVerb())
-        std::cout << "predicted variable: " << d_predictions.size()
-                  << std::endl;
-      d_predictions.resize(d_predictions.size() + 1);
-      closed = false;
+      const auto now = std::chrono::steady_clock::now().time_since_epoch();
+      const int64_t left =
+          deadline
+          - std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+      if (left <= 0)
+      {
+        Trace("tcp") << "tcp: timeout" << std::endl;
+        return false;
+      }
+      timeout = static_cast<int>(left);
     }
-    else if (input.peek() == ']')
+    struct pollfd pfd;
+    pfd.fd = d_socket;
+    pfd.events = events;
+    pfd.revents = 0;
+    const int rc = ::poll(&pfd, 1, timeout);
+    if (rc < 0 && errno == EINTR)
     {
-      skip(input, ']');
-      closed = true;
+      continue;
     }
-    else
+    if (rc == 0)
     {
-      double prediction;
-      input >> prediction;
-      if (options::tcpLearningVerb())
-        std::cout << "prediction received: " << prediction << std::endl;
-      d_predictions.back().push_back(prediction);
+      Trace("tcp") << "tcp: timeout" << std::endl;
+      return false;
     }
+    return rc > 0 && (pfd.revents & (events | POLLHUP | POLLERR)) != 0;
   }
-
-  return 0;
 }
-void TCPClient::close()
+
+void TCPClient::configure()
 {
-  if (!d_isOpen)
+  const std::string& host = options::tcpHost();
+  const unsigned short port = static_cast<unsigned short>(options::tcpPort());
+  if (host != d_host || port != d_port)
   {
-    return;
+    close();
+    d_host = host;
+    d_port = port;
   }
-  if (options::tcpLearningVerb()) std::cout << "client closed" << std::endl;
-  d_isOpen = false;
-  return d_client->close();
+  d_timeoutMs = d_withTimeout ? options::tcpTimeout() : 0;
+  d_verbosity = options::tcpLearningVerb();
 }
-}  // namespace cvc5
-
-#define _CRT_NONSTDC_NO_DEPRECATE
-#include <stdio.h>
-#include <string.h>
 
-#include <iostream>
-#include <string>
-/* #include "socket.hh" */
-
-int write_request(socket_t& socket, const char* buf_msg)
-{
-  std::string buf;
-  const size_t size_msg = strlen(buf_msg);
-  const auto number_string = std::to_string(size_msg);
-  const size_t buffer_size = size_msg + 1 + number_string.size() + 1;
-  char* buffer = new char[buffer_size];
-  memcpy(buffer, buf_msg, size_msg);
-  strncpy(buffer + size_msg, number_string.c_str(), number_string.size() + 1);
-  buffer[buffer_size - 1] = '\0';
-  buf = std::to_string(static_cast<long long unsigned int>(size_msg));
-  buf += "#";
-  buf += std::string(buf_msg);
-
-  const auto value = (socket.write_all(buf.data(), buf.size()));
-  /* const auto value = socket.write_all(buffer, buffer_size); */
-  delete[] buffer;
-  return value;
-}
-
-std::string read_response(socket_t& socket)
+bool TCPClient::open()
 {
-  std::string str_header;
-  // parse header one character at a time and look for #
-  // assume size header length less than 20 digits
-  str_header.reserve(20);
-  for (size_t idx = 0; idx < 20; idx++)
-  {
-    char c;
-    if (::recv(socket.m_sockfd, &c, 1, 0) == -1)
+  if (d_verbosity)
+  {
+    std::cout << "client connecting to: " << d_host << ":" << d_port
+              << std::endl;
+  }
+  struct addrinfo hints, *addresses;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  const std::string port = std::to_string(d_port);
+  if (::getaddrinfo(d_host.c_str(), port.c_str(), &hints, &addresses) != 0)
+  {
+    Trace("tcp") << "tcp: cannot resolve " << d_host << std::endl;
+    return false;
+  }
+  const int64_t connectDeadline = deadline();
+  for (auto address = addresses; address != nullptr && d_socket < 0;
+       address = address->ai_next)
+  {
+    d_socket = ::socket(
+        address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (d_socket < 0)
     {
-      std::cout << "recv error: " << strerror(errno) << std::endl;
-      return std::string();
+      continue;
     }
-    if (c == '#')
+    // all operations are non-blocking and wait through poll, so that they
+    // respect the timeout
+    ::fcntl(d_socket, F_SETFL, ::fcntl(d_socket, F_GETFL, 0) | O_NONBLOCK);
+    const int one = 1;
+    ::setsockopt(d_socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    bool connected =
+        ::connect(d_socket, address->ai_addr, address->ai_addrlen) == 0;
+    if (!connected && errno == EINPROGRESS && wait(POLLOUT, connectDeadline))
     {
-      break;
+      int error = 0;
+      socklen_t length = sizeof(error);
+      connected = ::getsockopt(d_socket, SOL_SOCKET, SO_ERROR, &error, &length)
+                      == 0
+                  && error == 0;
     }
-    else
+    if (!connected)
     {
-      str_header += c;
+      ::close(d_socket);
+      d_socket = -1;
     }
   }
-
-  size_t size_msg;
-  try
-  {
-    size_msg = static_cast<size_t>(std::stoi(str_header));
-  }
-  catch (const std::invalid_argument& ia)
+  ::freeaddrinfo(addresses);
+  if (d_socket < 0)
   {
-    std::cerr << "Error interpreting message header:" << str_header
-              << std::endl;
-    throw;
+    Trace("tcp") << "tcp: cannot connect to " << d_host << ":" << d_port
+                 << std::endl;
+    return false;
   }
-
-  // read from socket with known size
-  char* buf = new char[size_msg];
-  if (socket.read_all(buf, size_msg) < 0)
+  d_connectionCount++;
+  if (d_verbosity)
   {
-    std::cout << "recv error: " << strerror(errno) << std::endl;
-    return std::string();
+    std::cout << "client connected to: " << d_host << ":" << d_port << " <"
+              << d_socket << "> " << std::endl;
   }
-  std::string str_msg(buf, size_msg);
-  delete[] buf;
-  return str_msg;
+  return true;
 }
 
-socket_t::socket_t() : m_sockfd(0)
-{
-  memset(&m_sockaddr_in, 0, sizeof(m_sockaddr_in));
-}
-
-socket_t::socket_t(socketfd_t sockfd, sockaddr_in sock_addr)
-    : m_sockfd(sockfd), m_sockaddr_in(sock_addr)
-{
-}
-
-void socket_t::close()
+void TCPClient::close()
 {
-#if defined(_MSC_VER)
-  ::closesocket(m_sockfd);
-#else
-  ::close(m_sockfd);
-#endif
-  // clear members
-  memset(&m_sockaddr_in, 0, sizeof(m_sockaddr_in));
-  m_sockfd = 0;
+  if (d_socket < 0)
+  {
+    return;
+  }
+  if (d_verbosity)
+  {
+    std::cout << "client closed" << std::endl;
+  }
+  ::close(d_socket);
+  d_socket = -1;
 }
 
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-// socket_t::write_all
-//::send
-// http://man7.org/linux/man-pages/man2/send.2.html
-// The system calls send(), sendto(), and sendmsg() are used to transmit
-// a message to another socket.
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-
-int socket_t::write_all(const void* _buf, int size_buf)
+bool TCPClient::writeAll(const char* data, size_t size, int64_t deadline)
 {
-  const char* buf =
-      static_cast<const char*>(_buf);  // can't do pointer arithmetic on void*
-  int sent_size;                       // size in bytes sent or -1 on error
-  int size_left;                       // size in bytes left to send
-  const int flags = 0;
-  size_left = size_buf;
-  while (size_left > 0)
-  {
-    sent_size = ::send(m_sockfd, buf, size_left, flags);
-    if (-1 == sent_size)
+  while (size > 0)
+  {
+    const auto sent = ::send(d_socket, data, size, MSG_NOSIGNAL);
+    if (sent < 0)
     {
-      std::cout << "send error: " << strerror(errno) << std::endl;
-      return -1;
+      if ((errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+          && wait(POLLOUT, deadline))
+      {
+        continue;
+      }
+      Trace("tcp") << "tcp: send error: " << std::strerror(errno) << std::endl;
+      return false;
     }
-    size_left -= sent_size;
-    buf += sent_size;
+    data += sent;
+    size -= sent;
   }
-  return 1;
+  return true;
 }
 
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-// socket_t::read_all
-// read SIZE_BUF bytes of data from m_sockfd into buffer BUF
-// return total size read
-// http://man7.org/linux/man-pages/man2/recv.2.html
-// The recv(), recvfrom(), and recvmsg() calls are used to receive
-// messages from a socket.
-// NOTE: assumes : 1) blocking socket 2) socket closed , that makes ::recv
-// return 0
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-
-int socket_t::read_all(void* _buf, int size_buf)
+bool TCPClient::readAll(char* data, size_t size, int64_t deadline)
 {
-  char* buf = static_cast<char*>(_buf);  // can't do pointer arithmetic on void*
-  int recv_size;  // size in bytes received or -1 on error
-  int size_left;  // size in bytes left to send
-  const int flags = 0;
-  int total_recv_size = 0;
-  size_left = size_buf;
-  while (size_left > 0)
-  {
-    recv_size = ::recv(m_sockfd, buf, size_left, flags);
-    if (-1 == recv_size)
+  while (size > 0)
+  {
+    const auto received = ::recv(d_socket, data, size, 0);
+    if (received == 0)
     {
-      std::cout << "recv error: " << strerror(errno) << std::endl;
+      Trace("tcp") << "tcp: connection closed by server" << std::endl;
+      return false;
     }
-    // everything received, exit
-    if (0 == recv_size)
+    if (received < 0)
     {
-      break;
+      if ((errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+          && wait(POLLIN, deadline))
+      {
+        continue;
+      }
+      Trace("tcp") << "tcp: recv error: " << std::strerror(errno) << std::endl;
+      return false;
     }
-    size_left -= recv_size;
-    buf += recv_size;
-    total_recv_size += recv_size;
+    data += received;
+    size -= received;
   }
-  return total_recv_size;
+  return true;
 }
 
-///////////////////////////////////////////////////////////////////////////////////////
-// socket_t::hostname_to_ip
-// The getaddrinfo function provides protocol-independent translation from an
-// ANSI host name to an address
-///////////////////////////////////////////////////////////////////////////////////////
-
-int socket_t::hostname_to_ip(const char* host_name, char* ip)
+bool TCPClient::closedByServer()
 {
-  struct addrinfo hints, *servinfo, *p;
-  struct sockaddr_in* h;
-  int rv;
-
-  memset(&hints, 0, sizeof hints);
-  hints.ai_family = AF_UNSPEC;
-  hints.ai_socktype = SOCK_STREAM;
-  hints.ai_protocol = IPPROTO_TCP;
+  // the server only writes in response to a request, so an idle connection
+  // that is readable has been closed (or reset)
+  char byte;
+  const auto received = ::recv(d_socket, &byte, 1, MSG_PEEK);
+  return received == 0
+         || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+}
 
-  if ((rv = getaddrinfo(host_name, "http", &hints, &servinfo)) != 0)
+bool TCPClient::sendFrame(const char* payload, size_t size)
+{
+  if (d_fromOptions)
   {
-    return 1;
+    configure();
   }
-
-  for (p = servinfo; p != NULL; p = p->ai_next)
+  if (isOpen() && closedByServer())
   {
-    h = (struct sockaddr_in*)p->ai_addr;
-    strcpy(ip, inet_ntoa(h->sin_addr));
+    Trace("tcp") << "tcp: reconnecting" << std::endl;
+    close();
   }
-
-  freeaddrinfo(servinfo);
-  return 0;
-}
-
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-// tcp_client_t::tcp_client_t
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-
-tcp_client_t::tcp_client_t() : socket_t()
-{
-#if defined(_MSC_VER)
-  WSADATA ws_data;
-  if (WSAStartup(MAKEWORD(2, 0), &ws_data) != 0)
+  AlwaysAssert(size <= UINT32_MAX);
+  const uint32_t header = htonl(static_cast<uint32_t>(size));
+  // a lost connection is only noticed when writing, so try twice
+  for (size_t attempt = 0; attempt < 2; attempt++)
   {
-    exit(1);
+    if (!isOpen() && !open())
+    {
+      return false;
+    }
+    const int64_t frameDeadline = deadline();
+    if (writeAll(reinterpret_cast<const char*>(&header),
+                 sizeof(header),
+                 frameDeadline)
+        && writeAll(payload, size, frameDeadline))
+    {
+      if (d_verbosity > 1)
+      {
+        std::cout << "client sent " << size << " bytes" << std::endl;
+      }
+      return true;
+    }
+    close();
   }
-#endif
+  return false;
 }
 
-tcp_client_t::tcp_client_t(const char* host_name,
-                           const unsigned short server_port)
-    : socket_t(), m_server_port(server_port)
+bool TCPClient::receiveFrame(std::string& payload)
 {
-#if defined(_MSC_VER)
-  WSADATA ws_data;
-  if (WSAStartup(MAKEWORD(2, 0), &ws_data) != 0)
+  payload.clear();
+  if (!isOpen())
   {
-    exit(1);
+    return false;
   }
-#endif
-
-  char server_ip[100];
-
-  // get ip address from hostname
-  hostname_to_ip(host_name, server_ip);
-
-  // store
-  m_server_ip = server_ip;
+  const int64_t frameDeadline = deadline();
+  uint32_t header;
+  if (!readAll(reinterpret_cast<char*>(&header), sizeof(header), frameDeadline))
+  {
+    close();
+    return false;
+  }
+  payload.resize(ntohl(header));
+  if (!readAll(&payload[0], payload.size(), frameDeadline))
+  {
+    // the rest of the frame may still arrive, so the stream is out of sync
+    close();
+    payload.clear();
+    return false;
+  }
+  if (d_verbosity > 1)
+  {
+    std::cout << "client received " << payload.size() << " bytes"
+              << std::endl;
+  }
+  return true;
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
-// tcp_client_t::connect
-//::accept will block until a socket is opened with ::connect
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-
-int tcp_client_t::connect(const char* host_name,
-                          const unsigned short server_port)
+/** Append a 32-bit value in little endian to a request. */
+static void appendWord(std::string& buffer, uint32_t value)
 {
-  struct sockaddr_in server_addr;  // server address
-  char server_ip[100];
+  const char bytes[4] = {static_cast<char>(value & 0xff),
+                         static_cast<char>((value >> 8) & 0xff),
+                         static_cast<char>((value >> 16) & 0xff),
+                         static_cast<char>((value >> 24) & 0xff)};
+  buffer.append(bytes, sizeof(bytes));
+}
 
-  // get ip address from hostname
-  hostname_to_ip(host_name, server_ip);
+static uint32_t readWord(const char* bytes)
+{
+  const auto b = reinterpret_cast<const unsigned char*>(bytes);
+  return static_cast<uint32_t>(b[0]) | static_cast<uint32_t>(b[1]) << 8
+         | static_cast<uint32_t>(b[2]) << 16
+         | static_cast<uint32_t>(b[3]) << 24;
+}
 
-  // store
-  m_server_ip = server_ip;
-  m_server_port = server_port;
+TCPPredictor::TCPPredictor(TCPClient* client, size_t featureCount)
+    : d_client(client), d_featureCount(featureCount)
+{
+}
 
-  // create a stream socket using TCP
-  if ((m_sockfd = ::socket(PF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0)
+double TCPPredictor::predict(const float* features)
+{
+  std::vector<int32_t> indices;
+  std::vector<float> values;
+  for (size_t i = 0; i < d_featureCount; i++)
   {
-    std::cout << "socket error: " << std::endl;
-    return -1;
+    if (FP_ZERO != std::fpclassify(features[i]))
+    {
+      indices.push_back(i);
+      values.push_back(features[i]);
+    }
   }
+  return predictSparse(indices.data(), values.data(), indices.size());
+}
 
-  // construct the server address structure
-  memset(&server_addr, 0, sizeof(server_addr));  // zero out structure
-  server_addr.sin_family = AF_INET;              // internet address family
-  if (inet_pton(AF_INET, m_server_ip.c_str(), &server_addr.sin_addr)
-      <= 0)  // server IP address
+bool TCPPredictor::predictBatchCSR(const int32_t* rowStarts,
+                                   const int32_t* indices,
+                                   const float* values,
+                                   size_t rowCount,
+                                   double* out)
+{
+  static_assert(sizeof(float) == sizeof(uint32_t), "require 32-bit floats");
+  if (rowCount == 0)
   {
-    std::cout << "inet_pton error: " << strerror(errno) << std::endl;
-    return -1;
+    return true;
   }
-  server_addr.sin_port = htons(m_server_port);  // server port
-
-  // establish the connection to the server
-  if (::connect(m_sockfd, (struct sockaddr*)&server_addr, sizeof(server_addr))
-      < 0)
+  const size_t entryCount = rowStarts[rowCount];
+  d_request.clear();
+  d_request.reserve(9 + 4 * (rowCount + 1 + 2 * entryCount));
+  d_request.push_back('p');
+  appendWord(d_request, rowCount);
+  appendWord(d_request, entryCount);
+  for (size_t i = 0; i <= rowCount; i++)
   {
-    std::cout << "connect error: " << strerror(errno) << std::endl;
-    return -1;
+    appendWord(d_request, rowStarts[i]);
   }
-  return 0;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-// tcp_client_t::connect
-//::accept will block until a socket is opened with ::connect
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-
-int tcp_client_t::connect()
-{
-  struct sockaddr_in server_addr;  // server address
-
-  // create a stream socket using TCP
-  if ((m_sockfd = ::socket(PF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0)
+  for (size_t j = 0; j < entryCount; j++)
   {
-    std::cout << "socket error: " << std::endl;
-    return -1;
+    appendWord(d_request, indices[j]);
   }
-
-  // construct the server address structure
-  memset(&server_addr, 0, sizeof(server_addr));  // zero out structure
-  server_addr.sin_family = AF_INET;              // internet address family
-  if (inet_pton(AF_INET, m_server_ip.c_str(), &server_addr.sin_addr)
-      <= 0)  // server IP address
+  for (size_t j = 0; j < entryCount; j++)
   {
-    std::cout << "inet_pton error: " << strerror(errno) << std::endl;
-    return -1;
+    uint32_t word;
+    std::memcpy(&word, values + j, sizeof(word));
+    appendWord(d_request, word);
   }
-  server_addr.sin_port = htons(m_server_port);  // server port
 
-  // establish the connection to the server
-  if (::connect(m_sockfd, (struct sockaddr*)&server_addr, sizeof(server_addr))
-      < 0)
+  std::string response;
+  if (d_client->sendFrame(d_request.data(), d_request.size())
+      && d_client->receiveFrame(response)
+      && response.size() == sizeof(float) * rowCount)
   {
-    std::cout << "connect error: " << strerror(errno) << std::endl;
-    return -1;
+    for (size_t i = 0; i < rowCount; i++)
+    {
+      const uint32_t word = readWord(response.data() + sizeof(float) * i);
+      float score;
+      std::memcpy(&score, &word, sizeof(score));
+      out[i] = score;
+    }
+    return true;
   }
-  return 0;
-}
-
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-// tcp_client_t::~tcp_client_t
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-
-tcp_client_t::~tcp_client_t()
-{
-#if defined(_MSC_VER)
-  WSACleanup();
-#endif
+  Trace("ml") << "TCP predictor failed, falling back to the unguided order"
+              << std::endl;
+  d_failureCount++;
+  std::fill(out, out + rowCount, 0.0);
+  return false;
 }
-
+}  // namespace cvc5
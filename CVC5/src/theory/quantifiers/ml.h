@@ -2,55 +2,91 @@
 #define CVC4__ML
 
 #include <cmath>
+#include <cstring>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "base/check.h"
 #include "expr/node.h"
+#ifdef CVC5_USE_LIGHTGBM
 #include "lightgbm.h"
-class tcp_client_t;
+#endif
 
 namespace cvc5 {
+/**\brief A persistent connection to an external server.
+ *
+ * Messages are exchanged as frames, each consisting of the length of the
+ * payload as a 32-bit unsigned integer in network byte order followed by the
+ * payload itself. The connection is opened on first use and kept open;
+ * after an error it is closed and reopened by the next send. No operation
+ * blocks for longer than the timeout, if it is positive.
+ */
 class TCPClient
 {
  public:
+  /** The client of --tcp-model, connecting to --tcp-host and --tcp-port,
+   * and giving up after --tcp-timeout. */
   static TCPClient s_client;
+  /** The client of --tcp-learning, connecting to the same server as s_client
+   * but waiting for it without a timeout. */
+  static TCPClient s_learningClient;
+  TCPClient(const std::string& host, unsigned short port, int timeoutMs);
   virtual ~TCPClient();
-  static int sopen() { return s_client.open(); }
-  static void sclose() { return s_client.close(); }
+  /** Send a message to the server of s_learningClient, returns 0 on
+   * success. */
   static int send(const char* message)
   {
-    return s_client.send_internal(message);
+    return s_learningClient.sendFrame(message, std::strlen(message)) ? 0 : -1;
   }
-  static std::string receive() { return s_client.receive_internal(); }
-
- private:
-  TCPClient();
-  const unsigned short d_port = 8080;
-  const char d_server[255] = "127.0.0.1";  // server host name or IP
-  bool d_isOpen = false;
-  std::unique_ptr<tcp_client_t> d_client;
-  int open();
-  void close();
-  int send_internal(const char* message);
-  std::string receive_internal();
-};
-
-class TCPReader
-{
- public:
-  TCPReader() {}
-  virtual ~TCPReader() {}
-  int predict(const char* message);
-  const std::vector<std::vector<double> >& predictions() const
+  /** Receive a message from the server of s_learningClient, empty on
+   * failure. */
+  static std::string receive()
   {
-    return d_predictions;
+    std::string message;
+    s_learningClient.receiveFrame(message);
+    return message;
   }
 
+  /** Send a single frame, reconnecting once if the connection was lost. */
+  bool sendFrame(const char* payload, size_t size);
+  /** Receive a single frame. On failure the connection is closed. */
+  bool receiveFrame(std::string& payload);
+  bool isOpen() const { return d_socket >= 0; }
+  void close();
+  /** Number of connections opened so far. */
+  size_t connectionCount() const { return d_connectionCount; }
+
  private:
-  std::vector<std::vector<double> > d_predictions;
-  int receive();
+  /** Create a client configured by the options when sending, which follows
+   * --tcp-timeout if withTimeout is true and waits indefinitely otherwise. */
+  TCPClient(bool withTimeout);
+  /** whether the client follows --tcp-host, --tcp-port, --tcp-timeout and
+   * --tcp-learning-verb */
+  const bool d_fromOptions;
+  /** whether the client configured by the options follows --tcp-timeout */
+  const bool d_withTimeout;
+  std::string d_host;
+  unsigned short d_port;
+  int d_timeoutMs;
+  /** --tcp-learning-verb for the client configured by the options */
+  int d_verbosity;
+  int d_socket = -1;
+  size_t d_connectionCount = 0;
+  bool open();
+  /** Take the settings of the options for a client that follows them,
+   * closing the connection if the server changed. The options may differ
+   * between the problems of --batch. */
+  void configure();
+  /** Whether the server closed the connection since the last reply. */
+  bool closedByServer();
+  /** Wait until the socket is ready for the given poll events, or until the
+   * deadline (in milliseconds on the steady clock) passes. */
+  bool wait(short events, int64_t deadline);
+  int64_t deadline() const;
+  bool writeAll(const char* data, size_t size, int64_t deadline);
+  bool readAll(char* data, size_t size, int64_t deadline);
 };
 
 class PredictorInterface
@@ -58,7 +94,41 @@ class PredictorInterface
  public:
   virtual ~PredictorInterface() {}
   virtual double predict(const float* features) = 0;
+  /** Predict a batch of rows stored densely in row-major order, i.e., row i
+   * starts at rows + i * numberOfFeatures(). Results are written to out,
+   * which must have space for rowCount elements. */
+  virtual void predictBatch(const float* rows, size_t rowCount, double* out)
+  {
+    const size_t featureCount = numberOfFeatures();
+    for (size_t i = 0; i < rowCount; i++)
+    {
+      out[i] = predict(rows + i * featureCount);
+    }
+  }
+  /** Predict a batch of sparse rows in the compressed sparse row format,
+   * i.e., row i has the non-zero features indices[j] with values values[j]
+   * for rowStarts[i] <= j < rowStarts[i + 1]. Features whose index is not
+   * below numberOfFeatures() are ignored. Returns false if the scores could
+   * not be obtained, in which case out holds neutral scores that should not
+   * be remembered. */
+  virtual bool predictBatchCSR(const int32_t* rowStarts,
+                               const int32_t* indices,
+                               const float* values,
+                               size_t rowCount,
+                               double* out);
+  /** Predict a single sparse row. */
+  double predictSparse(const int32_t* indices,
+                       const float* values,
+                       size_t entryCount)
+  {
+    const int32_t rowStarts[2] = {0, static_cast<int32_t>(entryCount)};
+    double rv;
+    predictBatchCSR(rowStarts, indices, values, 1, &rv);
+    return rv;
+  }
   virtual size_t numberOfFeatures() const = 0;
+  /** Whether predictBatchCSR may be called from several threads at once. */
+  virtual bool isThreadSafe() const { return false; }
 };
 
 class Sigmoid : public PredictorInterface
@@ -88,27 +158,129 @@ class Sigmoid : public PredictorInterface
     return sigmoid(exponent);
   }
 
+  virtual bool predictBatchCSR(const int32_t* rowStarts,
+                               const int32_t* indices,
+                               const float* values,
+                               size_t rowCount,
+                               double* out) override
+  {
+    const size_t featureCount = numberOfFeatures();
+    for (size_t i = 0; i < rowCount; i++)
+    {
+      double exponent = d_coefficients[0];
+      for (int32_t j = rowStarts[i]; j < rowStarts[i + 1]; j++)
+      {
+        const size_t index = indices[j];
+        if (index < featureCount)
+        {
+          exponent += d_coefficients[index + 1] * values[j];
+        }
+      }
+      out[i] = sigmoid(exponent);
+    }
+    return true;
+  }
+
   virtual size_t numberOfFeatures() const override
   {
     return d_coefficients.size() - 1;
   }
+  virtual bool isThreadSafe() const override { return true; }
 
  protected:
   std::vector<double> d_coefficients;
 };
 
+#ifdef CVC5_USE_LIGHTGBM
 class LightGBMWrapper : public PredictorInterface
 {
  public:
   LightGBMWrapper(const char* modelFile);
   virtual double predict(const float* features) override;
+  virtual void predictBatch(const float* rows,
+                            size_t rowCount,
+                            double* out) override;
+  virtual bool predictBatchCSR(const int32_t* rowStarts,
+                               const int32_t* indices,
+                               const float* values,
+                               size_t rowCount,
+                               double* out) override;
   virtual ~LightGBMWrapper();
 
-  virtual size_t numberOfFeatures() const override;
+  virtual size_t numberOfFeatures() const override { return d_numFeatures; }
+  /** LightGBM serializes concurrent predictions of a booster itself. */
+  virtual bool isThreadSafe() const override { return true; }
 
  protected:
   BoosterHandle d_handle;
   int d_numIterations;
+  /** number of features expected by the model, queried once at load time */
+  size_t d_numFeatures;
+};
+#endif /* CVC5_USE_LIGHTGBM */
+
+/**\brief Predictor backed by a model server, see TCPClient.
+ *
+ * Each batch is sent in a single frame with the payload
+ *   'p', rowCount : u32, entryCount : u32,
+ *   rowStarts : i32[rowCount + 1], indices : i32[entryCount],
+ *   values : f32[entryCount]
+ * and the server answers with a frame holding rowCount scores as f32. All
+ * numbers are little endian. If the server cannot be reached or does not
+ * answer in time, all scores are 0, which leaves the terms in their
+ * unguided order.
+ */
+class TCPPredictor : public PredictorInterface
+{
+ public:
+  TCPPredictor(TCPClient* client, size_t featureCount);
+  virtual ~TCPPredictor() {}
+  virtual double predict(const float* features) override;
+  virtual bool predictBatchCSR(const int32_t* rowStarts,
+                               const int32_t* indices,
+                               const float* values,
+                               size_t rowCount,
+                               double* out) override;
+  virtual size_t numberOfFeatures() const override { return d_featureCount; }
+  /** Number of batches for which the server did not provide scores. */
+  size_t failureCount() const { return d_failureCount; }
+
+ protected:
+  TCPClient* const d_client;
+  const size_t d_featureCount;
+  size_t d_failureCount = 0;
+  /** buffer for the request frames */
+  std::string d_request;
+};
+
+/** Create a predictor for a LightGBM model file. If native is true, or cvc5
+ * is built without LightGBM, the model is evaluated by the built-in
+ * TreeEnsemble evaluator, otherwise by the LightGBM library. */
+PredictorInterface* mkLightGBMPredictor(const char* modelFile, bool native);
+
+/**\brief The predictors loaded from model files, kept for the lifetime of
+ * the process.
+ *
+ * Loading a model is paid once per process rather than once per SmtEngine,
+ * which matters when a single process solves many problems (--batch).
+ * Predictors keep no state between predictions, so they can be shared by
+ * consecutive solvers. Models are identified by their path, a file rewritten
+ * in place is not reloaded.
+ */
+class PredictorCache
+{
+ public:
+  static PredictorCache s_cache;
+  /** The predictor of mkLightGBMPredictor for the given arguments. */
+  PredictorInterface* getLightGBM(const std::string& modelFile, bool native);
+  /** The Sigmoid predictor for the given coefficients file. */
+  PredictorInterface* getSigmoid(const std::string& modelFile);
+
+ private:
+  /** predictors by kind and model file */
+  std::map<std::pair<std::string, std::string>,
+           std::unique_ptr<PredictorInterface>>
+      d_predictors;
 };
 }  // namespace cvc5
 
@@ -1690,7 +1690,7 @@ bool MatchGen::doMatching( QuantConflictFind * p, QuantInfo * qi ) {
             }else{
               //binding a variable
               d_qni_bound[index] = repVar;
-              std::map<TNode, TNodeTrie>::iterator it =
+              TNodeTrie::ChildMap::iterator it =
                   d_qn[index]->d_data.begin();
               if( it != d_qn[index]->d_data.end() ) {
                 d_qni.push_back( it );
@@ -1718,7 +1718,7 @@ bool MatchGen::doMatching( QuantConflictFind * p, QuantInfo * qi ) {
           if( !val.isNull() ){
             Node valr = p->getRepresentative(val);
             //constrained by val
-            std::map<TNode, TNodeTrie>::iterator it =
+            TNodeTrie::ChildMap::iterator it =
                 d_qn[index]->d_data.find(valr);
             if( it!=d_qn[index]->d_data.end() ){
               Debug("qcf-match-debug") << "       Match" << std::endl;
@@ -47,7 +47,7 @@ private:
   //MatchGen * getChild( int i ) { return &d_children[i]; }
   //current matching information
   std::vector<TNodeTrie*> d_qn;
-  std::vector<std::map<TNode, TNodeTrie>::iterator> d_qni;
+  std::vector<TNodeTrie::ChildMap::iterator> d_qni;
   bool doMatching( QuantConflictFind * p, QuantInfo * qi );
   //for matching : each index is either a variable or a ground term
   unsigned d_qni_size;
@@ -34,25 +34,6 @@ static Cvc5ostream& operator<<(
   return out << "[" << t.d_quantifier << " <- " << t.d_instantiation << "]";
 }
 
-static std::ostream& printSample(std::ostream& out,
-                                 int label,
-                                 const FeatureVector& features)
-
-{
-  out << label;
-  /* Assert(features.isFull()); */
-  const auto& values = features.values();
-  for (size_t i = 0; i < values.size(); i++)
-  {
-    const auto value = values[i];
-    if (FP_ZERO != std::fpclassify(value))
-    {
-      out << " " << i << ":" << value;
-    }
-  }
-  return out << std::endl;
-}
-
 QuantifierLogger QuantifierLogger::s_logger;
 
 QuantifierLogger::QuantifierInfo& QuantifierLogger::getQuantifierInfo(
@@ -90,6 +71,7 @@ void QuantifierLogger::increasePhase(Node quantifier)
 void QuantifierLogger::registerUsefulInstantiation(
     const InstantiationList& instantiations)
 {
+  d_hasUsefulInstantiations = true;
   auto& qi = getQuantifierInfo(instantiations.d_quant);
   for (const auto& instantiation : instantiations.d_inst)
   {
@@ -161,6 +143,30 @@ bool QuantifierLogger::registerCandidate(Node quantifier,
   return wasInserted;
 }
 
+void QuantifierLogger::unregisterCandidates(
+    Node quantifier,
+    const std::vector<std::pair<size_t, Node>>& candidates,
+    bool hadQuantifier,
+    bool increasedPhase)
+{
+  if (!hadQuantifier)
+  {
+    d_infos.erase(quantifier);
+    return;
+  }
+  auto& qi = getQuantifierInfo(quantifier);
+  for (const auto& [varIx, candidate] : candidates)
+  {
+    Assert(ContainsKey(qi.d_infos[varIx], candidate));
+    qi.d_infos[varIx].erase(candidate);
+  }
+  if (increasedPhase)
+  {
+    Assert(qi.d_currentPhase > 0);
+    qi.d_currentPhase--;
+  }
+}
+
 void QuantifierLogger::registerTryCandidate(Node quantifier,
                                             size_t varIx,
                                             Node candidate)
@@ -192,16 +198,19 @@ static std::ostream& printTupleSet(std::ostream& out,
   }
   return out;
 }
-std::ostream& QuantifierLogger::printTupleSample(
-    std::ostream& out,
+void QuantifierLogger::printTupleSample(
+    SampleWriter& out,
     Node quantifier,
     const QuantifierLogger::NodeVector& instantiation,
     FeatureVector& featureVector,
-    const Featurize& quantifierFeatures,
+    const QuantifierFeatures& quantifierFeatures,
     bool isUseful,
-    std::vector<std::map<Node, TermCandidateInfo>> termsInfo)
+    const std::vector<std::map<Node, TermCandidateInfo>>& termsInfo)
 {
-  out << "; " << isUseful << " : " << instantiation << std::endl;
+  if (!out.isBinary())
+  {
+    out.text() << "; " << isUseful << " : " << instantiation << std::endl;
+  }
   Assert(instantiation.size() == termsInfo.size());
   featureVector.push();
   // featurize each term separately
@@ -210,26 +219,33 @@ std::ostream& QuantifierLogger::printTupleSample(
     const Node& term = instantiation[varIx];
     ASSERT_EXISTENCE(termsInfo, term, varIx, quantifier);
     const auto& candidateInfo = termsInfo[varIx].at(term);
-    featurizeTerm(
-        &featureVector, term, varIx, candidateInfo, quantifierFeatures);
+    featurizeTerm(&featureVector,
+                  featureCache().getTermFeatures(term),
+                  varIx,
+                  candidateInfo,
+                  quantifierFeatures);
   }
-  printSample(out, isUseful, featureVector);
+  out.write(SampleWriter::SampleType::TUPLE, isUseful, featureVector);
   featureVector.pop();
-  return out;
 }
 
-std::ostream& QuantifierLogger::printTupleSamplesQuantifier(
-    std::ostream& out, Node quantifier, const QuantifierInfo& info)
+void QuantifierLogger::printTupleSamplesQuantifier(SampleWriter& out,
+                                                   Node quantifier,
+                                                   const QuantifierInfo& info)
 {
   const auto& allInstantiations = info.d_allInstantiations;
   const auto& termsInfo = info.d_infos;
   const auto& usefulInstantiations = info.d_usefulInstantiations;
   // calculate features for quantifier just once
-  Featurize quantifierFeatures(true);
-  quantifierFeatures.count(quantifier);
+  const auto& quantifierFeatures =
+      featureCache().getQuantifierFeatures(quantifier);
   FeatureVector featureVector(&TermTupleFeatureProperties::s_features);
   featurizeQuantifier(&featureVector, quantifierFeatures);
-  out << "; Q : " << quantifier << std::endl;
+  if (!out.isBinary())
+  {
+    out.text() << "; Q : " << quantifier << std::endl;
+  }
+  out.setQuantifier(quantifier);
   // featurize all the tuples
   for (const auto& instantiation : allInstantiations)
   {
@@ -243,27 +259,33 @@ std::ostream& QuantifierLogger::printTupleSamplesQuantifier(
                      useful,
                      termsInfo);
   }
-  return out;
 }
 
-std::ostream& QuantifierLogger::printTupleSamples(std::ostream& out)
+void QuantifierLogger::printTupleSamples(SampleWriter& out)
 {
-  out << "; TUPLE SAMPLES" << std::endl;
+  if (!out.isBinary())
+  {
+    out.text() << "; TUPLE SAMPLES" << std::endl;
+  }
   size_t maxSize = 0;
   for (const auto& entry : d_infos)  // go through all quantifiers
   {
     printTupleSamplesQuantifier(out, entry.first, entry.second);
     maxSize = std::max(maxSize, entry.second.d_infos.size());
   }
-  out << "; FEATURE_NAMES up to " << maxSize << " vars" << std::endl;
+  if (out.isBinary())
+  {
+    return;
+  }
+  auto& text = out.text();
+  text << "; FEATURE_NAMES up to " << maxSize << " vars" << std::endl;
   const auto& properties = TermTupleFeatureProperties::s_features;
   const auto& names = properties.names();
   for (size_t index = 0; index < properties.size(maxSize); index++)
   {
-    out << " " << index << ":" << names[index];
+    text << " " << index << ":" << names[index];
   }
-
-  return out << std::endl;
+  text << std::endl;
 }
 
 bool isFromInstantiation(Node n)
@@ -278,65 +300,72 @@ bool isFromInstantiation(Node n)
 void QuantifierLogger::transitiveExplanation()
 {
   Trace("ml") << "transitive explanation" << std::endl;
-  std::unordered_set<TNode, TNodeHashFunction> needsExplaining;
+  // index each subterm introduced by instantiations by the first instantiation
+  // whose body contains it, subterms of an indexed term are indexed already
+  std::unordered_map<TNode, size_t, TNodeHashFunction> introducedBy;
+  std::vector<TNode> todo;
+  for (size_t i = 0; i < d_instantiationBodies.size(); i++)
+  {
+    todo.push_back(d_instantiationBodies[i].d_body);
+    while (!todo.empty())
+    {
+      const TNode top = todo.back();
+      todo.pop_back();
+      if (!isFromInstantiation(top) || top.getKind() == Kind::FORALL) continue;
+      if (!introducedBy.insert({top, i}).second) continue;
+      todo.insert(todo.end(), top.begin(), top.end());
+    }
+  }
+
+  // explain the terms of useful instantiations, the instantiations used as
+  // reasons need to be explained in turn
+  std::vector<TNode> needsExplaining;
   for (const auto& entry : d_infos)
     for (const auto& i : entry.second.d_usefulInstantiations)
       for (const auto& n : i)
-        if (isFromInstantiation(n)) needsExplaining.insert(n);
+        if (isFromInstantiation(n)) needsExplaining.push_back(n);
 
   Trace("ml") << "Needs explanation:" << needsExplaining << std::endl;
-  size_t lastExplainedSize = 0;
-  while (!needsExplaining.empty()
-         && needsExplaining.size() != lastExplainedSize)
+  std::vector<bool> isReason(d_instantiationBodies.size(), false);
+  bool unexplained = false;
+  while (!needsExplaining.empty())
   {
-    lastExplainedSize = needsExplaining.size();
-    for (const auto& [quantifier, instantiation, body] : d_instantiationBodies)
-      findExplanation(
-          {quantifier, instantiation}, body, needsExplaining, d_reasons);
+    const TNode n = needsExplaining.back();
+    needsExplaining.pop_back();
+    if (ContainsKey(d_reasons, n)) continue;
+    const auto it = introducedBy.find(n);
+    if (it == introducedBy.end())
+    {
+      unexplained = true;
+      continue;
+    }
+    const auto& [quantifier, instantiation, body] =
+        d_instantiationBodies[it->second];
+    const InstantiationExplanation reason{quantifier, instantiation};
+    Trace("ml") << n << " explained by " << reason << std::endl;
+    d_reasons.insert({n, reason});
+    if (isReason[it->second]) continue;
+    isReason[it->second] = true;
+    for (const auto& t : instantiation)
+      if (isFromInstantiation(t) && !ContainsKey(d_reasons, t))
+        needsExplaining.push_back(t);
   }
-  if (!needsExplaining.empty())
+  if (unexplained)
     Trace("ml") << "Warning, some things remained unexplained" << std::endl;
   // join instantiations from the proof and reasons
-  for (auto [n, e] : d_reasons)
+  for (const auto& [n, e] : d_reasons)
   {
     d_infos.at(e.d_quantifier).d_usefulInstantiations.insert(e.d_instantiation);
   }
   Trace("ml") << "Done explaining" << std::endl;
 }
 
-void QuantifierLogger::findExplanation(
-    InstantiationExplanation reason,
-    Node body,
-    std::unordered_set<TNode, TNodeHashFunction>& needsExplaining,
-    std::map<Node, InstantiationExplanation>& reasons)
+void QuantifierLogger::printTermSamples(SampleWriter& out)
 {
-  std::vector<TNode> todo({body});
-  bool explainsSomething = false;
-  while (!needsExplaining.empty() && !todo.empty())
-  {
-    auto top(todo.back());
-    todo.pop_back();
-    if (!isFromInstantiation(top) || top.getKind() == Kind::FORALL) continue;
-    if (needsExplaining.erase(top) > 0)
-    {
-      Trace("ml") << top << " explained by " << reason << std::endl;
-      const auto it = reasons.insert({top, reason});
-      if (it.second) explainsSomething = true;
-    }
-    todo.insert(todo.end(), top.begin(), top.end());
-  }
-  // mark the reason as something to be explained
-  if (explainsSomething)
+  if (!out.isBinary())
   {
-    for (auto& n : reason.d_instantiation)
-      if (isFromInstantiation(n) && !ContainsKey(reasons, n))
-        needsExplaining.insert(n);
+    out.text() << "; SAMPLES" << std::endl;
   }
-}
-
-std::ostream& QuantifierLogger::printTermSamples(std::ostream& out)
-{
-  out << "; SAMPLES" << std::endl;
   for (const auto& entry : d_infos)  // going through all quantifiers
   {
     const auto& quantifier = entry.first;
@@ -344,10 +373,11 @@ std::ostream& QuantifierLogger::printTermSamples(std::ostream& out)
     const auto& infos = entry.second.d_infos;
     const auto variableCount = infos.size();
     // calculate features for quantifier just once
-    Featurize quantifierFeatures(true);
-    quantifierFeatures.count(quantifier);
+    const auto& quantifierFeatures =
+        featureCache().getQuantifierFeatures(quantifier);
     FeatureVector featureVector(&TermFeatureProperties::s_features);
     featurizeQuantifier(&featureVector, quantifierFeatures);
+    out.setQuantifier(quantifier);
 
     // for each variable calculate if a term was ever useful
     std::vector<std::set<Node>> usefulPerVariable(variableCount);
@@ -373,21 +403,29 @@ std::ostream& QuantifierLogger::printTermSamples(std::ostream& out)
 
         const auto useful = ContainsKey(usefulPerVariable[varIx], term) ? 1 : 0;
         featureVector.push();
-        featurizeTerm(
-            &(featureVector), term, varIx, candidateInfo, quantifierFeatures);
-        printSample(out, useful, featureVector);
+        featurizeTerm(&featureVector,
+                      featureCache().getTermFeatures(term),
+                      varIx,
+                      candidateInfo,
+                      quantifierFeatures);
+        out.write(SampleWriter::SampleType::TERM, useful, featureVector);
         featureVector.pop();
       }
     }
   }
 
-  out << "; FEATURE_NAMES";
+  if (out.isBinary())
+  {
+    return;
+  }
+  auto& text = out.text();
+  text << "; FEATURE_NAMES";
   const auto& names = TermFeatureProperties::s_features.names();
   for (size_t index = 0; index < names.size(); index++)
   {
-    out << " " << index << ":" << names[index];
+    text << " " << index << ":" << names[index];
   }
-  return out << std::endl;
+  text << std::endl;
 }
 std::ostream& QuantifierLogger::printExtensive(std::ostream& out)
 {
@@ -469,11 +507,31 @@ std::ostream& QuantifierLogger::print(std::ostream& out)
 {
   if (options::mlParents()) transitiveExplanation();
   printExtensive(out);
-  printTermSamples(out);
-  printTupleSamples(out);
+  printSamples(out);
   clear();
   return out;
 }
+
+void QuantifierLogger::printSamples(std::ostream& out)
+{
+  if (options::qloggingOut().empty())
+  {
+    SampleWriter samples(out);
+    printTermSamples(samples);
+    printTupleSamples(samples);
+    return;
+  }
+  if (!d_sampleFile || d_sampleFileName != options::qloggingOut())
+  {
+    d_sampleFileName = options::qloggingOut();
+    d_sampleFile.reset(new SampleWriter(
+        options::qloggingOut(),
+        options::qloggingFormat() == options::QloggingFormatMode::BINARY));
+  }
+  printTermSamples(*d_sampleFile);
+  printTupleSamples(*d_sampleFile);
+  d_sampleFile->flush();
+}
 }  // namespace quantifiers
 }  // namespace theory
 }  // namespace cvc5
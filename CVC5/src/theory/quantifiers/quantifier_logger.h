@@ -2,6 +2,7 @@
 #define QUANTIFIER_LOGGER_H_15196
 #include <fstream>
 #include <map>
+#include <memory>
 #include <set>
 #include <unordered_map>
 
@@ -9,6 +10,7 @@
 #include "theory/quantifiers/featurize.h"
 #include "theory/quantifiers/inst_match_trie.h"
 #include "theory/quantifiers/instantiation_list.h"
+#include "theory/quantifiers/sample_writer.h"
 #include "theory/quantifiers/term_tuple_enumerator_utils.h"
 #include "theory/quantifiers_engine.h"
 
@@ -57,6 +59,15 @@ class QuantifierLogger
                          size_t varIx,
                          Node candidate,
                          bool relevant);
+  /** Undo the registration of candidates, given as variable indices and
+   * terms, which were the last ones registered for the quantifier, and the
+   * last increasePhase if increasedPhase. If the quantifier was not known
+   * before, as given by hadQuantifier, it is forgotten altogether. */
+  void unregisterCandidates(
+      Node quantifier,
+      const std::vector<std::pair<size_t, Node>>& candidates,
+      bool hadQuantifier,
+      bool increasedPhase);
 
   NodeVector registerInstantiationAttempt(Node quantifier,
                                           const std::vector<Node>& inst);
@@ -66,6 +77,9 @@ class QuantifierLogger
                              const NodeVector& inst);
 
   void registerUsefulInstantiation(const InstantiationList& instantiations);
+  /** Whether the useful instantiations were registered, so that the
+   * instantiations not among them are known to be useless. */
+  bool hasUsefulInstantiations() const { return d_hasUsefulInstantiations; }
   /* void registerInstantiations(Node quantifier, QuantifiersEngine*); */
 
   size_t getCurrentPhase(Node quantifier) const;
@@ -78,12 +92,36 @@ class QuantifierLogger
     return ContainsKey(d_infos, quantifier);
   }
 
+  /** Use the given cache for features of terms and quantifiers when printing
+   * samples, or a private one if null. */
+  void setFeatureCache(FeatureCache* featureCache)
+  {
+    d_featureCache = featureCache;
+  }
+  FeatureCache* getFeatureCache() const { return d_featureCache; }
+  /** Forget everything logged so far. Called when the solver owning the
+   * logged nodes is destroyed, so that the next solver of the process starts
+   * afresh, see --batch. */
+  void reset()
+  {
+    clear();
+    d_currentInstantiationBody = Node::null();
+    d_currentInstantiationQuantifier = Node::null();
+  }
+
   virtual ~QuantifierLogger() { clear(); }
 
  protected:
   std::map<Node, QuantifierInfo> d_infos;
   std::vector<InstantiationInfo> d_instantiationBodies;
   std::map<Node, InstantiationExplanation> d_reasons;
+  FeatureCache* d_featureCache = nullptr;
+  FeatureCache d_localFeatureCache;
+  bool d_hasUsefulInstantiations = false;
+  /** the file of --qlogging-out, kept open across calls of print */
+  std::unique_ptr<SampleWriter> d_sampleFile;
+  /** the name d_sampleFile was opened with, reopened when it changes */
+  std::string d_sampleFileName;
 
   QuantifierLogger() {}
   void registerTryCandidate(Node quantifier, size_t varIx, Node candidate);
@@ -94,28 +132,35 @@ class QuantifierLogger
     d_infos.clear();
     d_instantiationBodies.clear();
     d_reasons.clear();
+    d_localFeatureCache.clear();
+    d_hasUsefulInstantiations = false;
+  }
+  FeatureCache& featureCache()
+  {
+    return d_featureCache ? *d_featureCache : d_localFeatureCache;
   }
+  /** Mark as useful also the instantiations that introduced terms of useful
+   * instantiations, transitively. The cost is linear in the size of the
+   * instantiation bodies. */
   void transitiveExplanation();
-  void findExplanation(
-      InstantiationExplanation reason,
-      Node body,
-      std::unordered_set<TNode, TNodeHashFunction>& needsExplaining,
-      std::map<Node, InstantiationExplanation>& reasons);
 
   std::ostream& printExtensive(std::ostream& out);
-  std::ostream& printTermSamples(std::ostream& out);
-  std::ostream& printTupleSamples(std::ostream& out);
-  std::ostream& printTupleSamplesQuantifier(std::ostream& out,
-                                            Node quantifier,
-                                            const QuantifierInfo& info);
-  std::ostream& printTupleSample(
-      std::ostream& out,
+  /** Write the training samples to the given stream, or to the file of
+   * --qlogging-out if given. */
+  void printSamples(std::ostream& out);
+  void printTermSamples(SampleWriter& out);
+  void printTupleSamples(SampleWriter& out);
+  void printTupleSamplesQuantifier(SampleWriter& out,
+                                   Node quantifier,
+                                   const QuantifierInfo& info);
+  void printTupleSample(
+      SampleWriter& out,
       Node quantifier,
       const QuantifierLogger::NodeVector& instantiation,
       FeatureVector& featureVector,
-      const Featurize& quantifierFeatures,
+      const QuantifierFeatures& quantifierFeatures,
       bool isUseful,
-      std::vector<std::map<Node, TermCandidateInfo>> termsInfo);
+      const std::vector<std::map<Node, TermCandidateInfo>>& termsInfo);
 };
 
 }  // namespace quantifiers
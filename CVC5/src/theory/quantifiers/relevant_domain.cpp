@@ -15,6 +15,7 @@
 
 #include "theory/quantifiers/relevant_domain.h"
 
+#include "options/quantifiers_options.h"
 #include "theory/arith/arith_msum.h"
 #include "theory/quantifiers/first_order_model.h"
 #include "theory/quantifiers/quantifiers_registry.h"
@@ -33,14 +34,28 @@ void RelevantDomain::RDomain::merge( RDomain * r ) {
   Assert(!d_parent);
   Assert(!r->d_parent);
   d_parent = r;
-  for( unsigned i=0; i<d_terms.size(); i++ ){
-    r->addTerm( d_terms[i] );
+  // splice the smaller domain into the larger one, so that every term is
+  // re-added O(log n) times over a sequence of merges
+  if (d_added.size() > r->d_added.size())
+  {
+    d_terms.swap(r->d_terms);
+    d_added.swap(r->d_added);
+    d_termSet.swap(r->d_termSet);
   }
-  d_terms.clear();
+  for (const Node& t : d_added)
+  {
+    r->addTerm(t);
+  }
+  // release the memory, the terms are only accessed through the parent
+  std::vector<Node>().swap(d_terms);
+  std::vector<Node>().swap(d_added);
+  std::unordered_set<Node, NodeHashFunction>().swap(d_termSet);
 }
 
 void RelevantDomain::RDomain::addTerm( Node t ) {
-  if( std::find( d_terms.begin(), d_terms.end(), t )==d_terms.end() ){
+  if (d_termSet.insert(t).second)
+  {
+    d_added.push_back(t);
     d_terms.push_back( t );
   }
 }
@@ -57,26 +72,31 @@ RelevantDomain::RDomain * RelevantDomain::RDomain::getParent() {
 
 void RelevantDomain::RDomain::removeRedundantTerms(QuantifiersState& qs)
 {
-  std::map< Node, Node > rterms;
-  for( unsigned i=0; i<d_terms.size(); i++ ){
-    Node r = d_terms[i];
-    if( !TermUtil::hasInstConstAttr( d_terms[i] ) ){
-      r = qs.getRepresentative(d_terms[i]);
+  std::unordered_set<Node, NodeHashFunction> reps;
+  d_terms.clear();
+  for (const Node& t : d_added)
+  {
+    Node r = t;
+    if (!TermUtil::hasInstConstAttr(t))
+    {
+      r = qs.getRepresentative(t);
     }
-    if( rterms.find( r )==rterms.end() ){
-      rterms[r] = d_terms[i];
+    if (reps.insert(r).second)
+    {
+      d_terms.push_back(t);
     }
   }
-  d_terms.clear();
-  for( std::map< Node, Node >::iterator it = rterms.begin(); it != rterms.end(); ++it ){
-    d_terms.push_back( it->second );
-  }
 }
 
 RelevantDomain::RelevantDomain(QuantifiersState& qs,
                                QuantifiersRegistry& qr,
                                TermRegistry& tr)
-    : d_qs(qs), d_qreg(qr), d_treg(tr)
+    : d_qs(qs),
+      d_qreg(qr),
+      d_treg(tr),
+      d_generation(0),
+      d_computedGeneration(qs.getSatContext(), 0),
+      d_quantifiersProcessed(0)
 {
   d_is_computed = false;
 }
@@ -106,21 +126,47 @@ bool RelevantDomain::reset( Theory::Effort e ) {
 }
 
 void RelevantDomain::registerQuantifier(Node q) {}
+void RelevantDomain::resetDomains()
+{
+  for (std::pair<const Node, std::map<int, RDomain*>>& rds : d_rel_doms)
+  {
+    for (std::pair<const int, RDomain*>& rd : rds.second)
+    {
+      rd.second->reset();
+    }
+  }
+  d_quantifiersProcessed = 0;
+  d_groundTermsProcessed.clear();
+}
+
 void RelevantDomain::compute(){
   if( !d_is_computed ){
     d_is_computed = true;
-    for( std::map< Node, std::map< int, RDomain * > >::iterator it = d_rel_doms.begin(); it != d_rel_doms.end(); ++it ){
-      for( std::map< int, RDomain * >::iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2 ){
-        it2->second->reset();
-      }
+    // The domains computed so far can be extended if none of the terms and
+    // quantified formulas they were computed from were retracted. Merges of
+    // equivalence classes are accounted for by removeRedundantTerms below,
+    // which filters all terms added so far anew.
+    const bool incremental = options::relevantDomainIncremental()
+                             && d_generation > 0
+                             && d_computedGeneration.get() == d_generation;
+    d_computedGeneration = ++d_generation;
+    if (!incremental)
+    {
+      resetDomains();
     }
+    Trace("rel-dom-debug") << "compute relevant domain, incremental: "
+                           << incremental << std::endl;
     FirstOrderModel* fm = d_treg.getModel();
-    for( unsigned i=0; i<fm->getNumAssertedQuantifiers(); i++ ){
+    const size_t nquant = fm->getNumAssertedQuantifiers();
+    Assert(d_quantifiersProcessed <= nquant);
+    for (size_t i = d_quantifiersProcessed; i < nquant; i++)
+    {
       Node q = fm->getAssertedQuantifier( i );
       Node icf = d_qreg.getInstConstantBody(q);
       Trace("rel-dom-debug") << "compute relevant domain for " << icf << std::endl;
       computeRelevantDomain( q, icf, true, true );
     }
+    d_quantifiersProcessed = nquant;
 
     Trace("rel-dom-debug") << "account for ground terms" << std::endl;
     TermDb* db = d_treg.getTermDatabase();
@@ -128,7 +174,10 @@ void RelevantDomain::compute(){
     {
       Node op = db->getOperator(k);
       unsigned sz = db->getNumGroundTerms( op );
-      for( unsigned i=0; i<sz; i++ ){
+      size_t& processed = d_groundTermsProcessed[op];
+      Assert(processed <= sz);
+      for (unsigned i = processed; i < sz; i++)
+      {
         Node n = db->getGroundTerm(op, i);
         //if it is a non-redundant term
         if( db->isTermActive( n ) ){
@@ -139,6 +188,7 @@ void RelevantDomain::compute(){
           }
         }
       }
+      processed = sz;
     }
     //print debug
     for( std::map< Node, std::map< int, RDomain * > >::iterator it = d_rel_doms.begin(); it != d_rel_doms.end(); ++it ){
@@ -18,6 +18,10 @@
 #ifndef CVC5__THEORY__QUANTIFIERS__RELEVANT_DOMAIN_H
 #define CVC5__THEORY__QUANTIFIERS__RELEVANT_DOMAIN_H
 
+#include <unordered_map>
+#include <unordered_set>
+
+#include "context/cdo.h"
 #include "theory/quantifiers/first_order_model.h"
 #include "theory/quantifiers/quant_util.h"
 
@@ -71,17 +75,21 @@ class RelevantDomain : public QuantifiersUtil
   {
   public:
     RDomain() : d_parent( NULL ) {}
-    /** the set of terms in this relevant domain */
+    /** the set of terms in this relevant domain, in the order of insertion,
+     * without duplicates modulo equality after removeRedundantTerms */
     std::vector< Node > d_terms;
     /** reset this object */
     void reset()
     {
       d_parent = NULL;
       d_terms.clear();
+      d_added.clear();
+      d_termSet.clear();
     }
     /** merge this with r
-     * This sets d_parent of this to r and
-     * copies the terms of this to r.
+     * This sets d_parent of this to r. The terms of r are the terms of the
+     * larger of the two domains, in their order, followed by the terms of
+     * the smaller one missing in the larger one.
      */
     void merge( RDomain * r );
     /** add term to the relevant domain */
@@ -89,15 +97,21 @@ class RelevantDomain : public QuantifiersUtil
     /** get the parent of this */
     RDomain * getParent();
     /** remove redundant terms for d_terms, removes
-     * duplicates modulo equality.
+     * duplicates modulo equality, keeping the first term of each class. The
+     * added terms are kept, so that this can be repeated after the
+     * equivalence classes have changed.
      */
     void removeRedundantTerms(QuantifiersState& qs);
     /** is n in this relevant domain? */
-    bool hasTerm( Node n ) { return std::find( d_terms.begin(), d_terms.end(), n )!=d_terms.end(); }
+    bool hasTerm(Node n) const { return d_termSet.count(n) > 0; }
 
    private:
     /** the parent of this relevant domain */
     RDomain* d_parent;
+    /** all terms added to this relevant domain, in the order of insertion */
+    std::vector<Node> d_added;
+    /** the elements of d_added, for constant time membership tests */
+    std::unordered_set<Node, NodeHashFunction> d_termSet;
   };
   /** get the relevant domain
    *
@@ -130,6 +144,19 @@ class RelevantDomain : public QuantifiersUtil
   TermRegistry& d_treg;
   /** have we computed the relevant domain on this full effort check? */
   bool d_is_computed;
+  /** number of computations of the relevant domain */
+  size_t d_generation;
+  /** the value of d_generation at the last computation, reverts to a smaller
+   * value when the SAT context is backtracked below the level of the last
+   * computation, in which case the relevant domains may contain terms that
+   * are no longer asserted */
+  context::CDO<size_t> d_computedGeneration;
+  /** number of asserted quantified formulas whose bodies were processed */
+  size_t d_quantifiersProcessed;
+  /** number of ground terms processed for each operator */
+  std::unordered_map<Node, size_t, NodeHashFunction> d_groundTermsProcessed;
+  /** Reset all relevant domains. */
+  void resetDomains();
   /** relevant domain literal
    * Caches the effect of literals on the relevant domain.
    */
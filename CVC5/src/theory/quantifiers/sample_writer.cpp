@@ -0,0 +1,96 @@
+#include "theory/quantifiers/sample_writer.h"
+
+#include <sstream>
+
+#include "base/check.h"
+
+namespace cvc5 {
+namespace theory {
+namespace quantifiers {
+
+/** Size of the stream buffer of sample files. */
+static const size_t s_bufferSize = 1 << 20;
+
+SampleWriter::SampleWriter(std::ostream& out) : d_binary(false), d_out(&out)
+{
+}
+
+SampleWriter::SampleWriter(const std::string& fileName, bool binary)
+    : d_binary(binary), d_buffer(s_bufferSize), d_file(new std::ofstream())
+{
+  // the buffer must be set before the file is opened
+  d_file->rdbuf()->pubsetbuf(d_buffer.data(), d_buffer.size());
+  d_file->open(fileName,
+               binary ? std::ios::out | std::ios::binary : std::ios::out);
+  AlwaysAssert(d_file->is_open())
+      << "cannot open the sample file " << fileName << std::endl;
+  d_out = d_file.get();
+  if (d_binary)
+  {
+    const uint32_t byteOrderMark = 0x01020304;
+    d_out->write("CVC5SMPL", 8);
+    writeRaw(&s_version, 1);
+    writeRaw(&byteOrderMark, 1);
+  }
+}
+
+SampleWriter::~SampleWriter() { flush(); }
+
+std::ostream& SampleWriter::text()
+{
+  Assert(!d_binary);
+  return *d_out;
+}
+
+void SampleWriter::setQuantifier(Node quantifier)
+{
+  if (!d_binary)
+  {
+    return;
+  }
+  std::stringstream ss;
+  ss << quantifier;
+  const std::string name = ss.str();
+  const auto [it, wasInserted] =
+      d_quantifierIds.insert({name, d_quantifierIds.size()});
+  d_currentQuantifierId = it->second;
+  if (wasInserted)
+  {
+    const uint32_t length = name.size();
+    d_out->put('Q');
+    writeRaw(&d_currentQuantifierId, 1);
+    writeRaw(&length, 1);
+    d_out->write(name.data(), name.size());
+  }
+}
+
+void SampleWriter::write(SampleType type,
+                         int label,
+                         const FeatureVector& features)
+{
+  const auto& indices = features.indices();
+  const auto& values = features.values();
+  if (!d_binary)
+  {
+    auto& out = *d_out;
+    out << label;
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+      out << " " << indices[i] << ":" << values[i];
+    }
+    out << "\n";
+    return;
+  }
+  const uint8_t labelByte = label;
+  const uint32_t entryCount = indices.size();
+  d_out->put(static_cast<char>(type));
+  writeRaw(&labelByte, 1);
+  writeRaw(&d_currentQuantifierId, 1);
+  writeRaw(&entryCount, 1);
+  writeRaw(indices.data(), entryCount);
+  writeRaw(values.data(), entryCount);
+}
+
+}  // namespace quantifiers
+}  // namespace theory
+}  // namespace cvc5
@@ -0,0 +1,81 @@
+#ifndef CVC5__THEORY__QUANTIFIERS__SAMPLE_WRITER_H
+#define CVC5__THEORY__QUANTIFIERS__SAMPLE_WRITER_H
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "expr/node.h"
+#include "theory/quantifiers/featurize.h"
+
+namespace cvc5 {
+namespace theory {
+namespace quantifiers {
+
+/**\brief Destination of the training samples of the quantifier logger.
+ *
+ * In the text format each sample is a line in the SVMlight format, preceded
+ * by comments that identify the quantifier and the sections of samples, as
+ * expected by loop/scripts/loop.py.
+ *
+ * The binary format (--qlogging-format=binary) is meant to be memory-mapped
+ * by loop/scripts/samples.py. It starts with a header consisting of the magic
+ * "CVC5SMPL", the format version (u32) and the byte order mark 0x01020304
+ * (u32). All numbers are in the byte order of the writing machine. The
+ * header is followed by records, each starting with a type byte:
+ *  - 'Q' a quantifier: its id (u32), the length of its text (u32) and the
+ *    text; written before the first sample of the quantifier,
+ *  - 'T' a term sample and 'U' a tuple sample: the label (u8), the id of the
+ *    quantifier (u32), the number of non-zero features (u32), their indices
+ *    (i32 each) and their values (f32 each).
+ * Writes go through a large stream buffer, the features are written straight
+ * from the feature vector.*/
+class SampleWriter
+{
+ public:
+  enum class SampleType : char
+  {
+    TERM = 'T',
+    TUPLE = 'U'
+  };
+  static constexpr uint32_t s_version = 1;
+  /** Write the samples in the text format to the given stream. */
+  SampleWriter(std::ostream& out);
+  /** Write the samples to the given file, which is truncated. */
+  SampleWriter(const std::string& fileName, bool binary);
+  ~SampleWriter();
+  bool isBinary() const { return d_binary; }
+  /** The stream for comments of the text format, must not be used for the
+   * binary format. */
+  std::ostream& text();
+  /** Make the given quantifier the one of the following samples. */
+  void setQuantifier(Node quantifier);
+  void write(SampleType type, int label, const FeatureVector& features);
+  void flush() { d_out->flush(); }
+
+ private:
+  const bool d_binary;
+  /** buffer of d_file, declared first so that it outlives the file */
+  std::vector<char> d_buffer;
+  std::unique_ptr<std::ofstream> d_file;
+  std::ostream* d_out;
+  /** ids of quantifiers by their text, in the order of their first use;
+   * the text is used so that no nodes outlive the logger's rounds */
+  std::unordered_map<std::string, uint32_t> d_quantifierIds;
+  uint32_t d_currentQuantifierId = 0;
+  template <class T>
+  void writeRaw(const T* data, size_t count)
+  {
+    d_out->write(reinterpret_cast<const char*>(data), sizeof(T) * count);
+  }
+};
+
+}  // namespace quantifiers
+}  // namespace theory
+}  // namespace cvc5
+
+#endif /* CVC5__THEORY__QUANTIFIERS__SAMPLE_WRITER_H */
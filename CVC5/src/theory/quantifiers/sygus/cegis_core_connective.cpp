@@ -453,9 +453,9 @@ Node CegisCoreConnective::Component::getRefinementPt(
   std::vector<Node> ctx;
 
   unsigned depth = p->d_vars.size();
-  std::map<NodeTrie*, std::map<Node, NodeTrie>::iterator> vt;
-  std::map<NodeTrie*, std::map<Node, NodeTrie>::iterator>::iterator itvt;
-  std::map<Node, NodeTrie>::iterator itv;
+  std::map<NodeTrie*, NodeTrie::ChildMap::iterator> vt;
+  std::map<NodeTrie*, NodeTrie::ChildMap::iterator>::iterator itvt;
+  NodeTrie::ChildMap::iterator itv;
   std::vector<NodeTrie*> visit;
   NodeTrie* cur;
   visit.push_back(&d_refinementPt);
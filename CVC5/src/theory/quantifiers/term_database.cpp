@@ -48,7 +48,9 @@ TermDb::TermDb(QuantifiersState& qs, QuantifiersRegistry& qr)
       d_typeMap(d_termsContextUse),
       d_ops(d_termsContextUse),
       d_opMap(d_termsContextUse),
-      d_inactive_map(qs.getSatContext())
+      d_inactive_map(qs.getSatContext()),
+      d_generation(0),
+      d_computedGeneration(qs.getSatContext(), 0)
 {
   d_consistent_ee = true;
   d_true = NodeManager::currentNM()->mkConst(true);
@@ -297,6 +299,11 @@ void TermDb::computeUfEqcTerms(TNode f)
     return;
   }
   d_func_map_eqc_trie[f].clear();
+  const bool incremental = options::termDbIncremental();
+  if (incremental)
+  {
+    d_opTermsIndexed[f] = getNumGroundTerms(f);
+  }
   // get the matchable operators in the equivalence class of f
   std::vector<TNode> ops;
   ops.push_back(f);
@@ -315,6 +322,14 @@ void TermDb::computeUfEqcTerms(TNode f)
         computeArgReps(n);
         TNode r = ee->hasTerm(n) ? ee->getRepresentative(n) : TNode(n);
         d_func_map_eqc_trie[f].d_data[r].addTerm(n, d_arg_reps[n]);
+        if (incremental)
+        {
+          addRepresentativeUser(r, f);
+          for (TNode ar : d_arg_reps[n])
+          {
+            addRepresentativeUser(ar, f);
+          }
+        }
       }
     }
   }
@@ -329,6 +344,11 @@ void TermDb::computeUfTerms(TNode f)
   }
   Assert(f == getOperatorRepresentative(f));
   d_op_nonred_count[f] = 0;
+  const bool incremental = options::termDbIncremental();
+  if (incremental)
+  {
+    d_opTermsIndexed[f] = getNumGroundTerms(f);
+  }
   // get the matchable operators in the equivalence class of f
   std::vector<TNode> ops;
   ops.push_back(f);
@@ -357,6 +377,11 @@ void TermDb::computeUfTerms(TNode f)
       if (!hasTermCurrent(n) || !d_qstate.hasTerm(n))
       {
         Trace("term-db-debug") << n << " is not relevant." << std::endl;
+        if (incremental)
+        {
+          // the index must be recomputed once n enters the EE
+          addRepresentativeUser(n, f);
+        }
         continue;
       }
 
@@ -383,6 +408,14 @@ void TermDb::computeUfTerms(TNode f)
       }
       Trace("term-db-debug") << std::endl;
       Assert(d_qstate.hasTerm(n));
+      if (incremental)
+      {
+        addRepresentativeUser(d_qstate.getRepresentative(n), f);
+        for (TNode ar : d_arg_reps[n])
+        {
+          addRepresentativeUser(ar, f);
+        }
+      }
       Trace("term-db-debug")
           << "  and value : " << d_qstate.getRepresentative(n) << std::endl;
       Node at = d_func_map_trie[f].addOrGetTerm(n, d_arg_reps[n]);
@@ -1089,6 +1122,8 @@ void TermDb::setHasTerm(Node n)
 
 void TermDb::presolve()
 {
+  // the term lists may be cleared below
+  d_generation++;
   if (options::incrementalSolving() && !options::termDbCd())
   {
     d_termsContext.pop();
@@ -1096,13 +1131,93 @@ void TermDb::presolve()
   }
 }
 
-bool TermDb::reset(Theory::Effort effort)
+void TermDb::addRepresentativeUser(TNode r, TNode f)
+{
+  std::vector<Node>& users = d_repUsers[r];
+  // the terms of an operator are indexed consecutively
+  if (users.empty() || users.back() != f)
+  {
+    users.push_back(f);
+  }
+}
+
+void TermDb::eqNotifyMerge(TNode t1, TNode t2)
+{
+  // nothing to record if the indices are rebuilt anyway
+  if (options::termDbIncremental()
+      && d_computedGeneration.get() == d_generation)
+  {
+    d_eqChanges.push_back(t2);
+  }
+}
+
+void TermDb::eqNotifyNewClass(TNode t)
+{
+  if (options::termDbIncremental()
+      && d_computedGeneration.get() == d_generation)
+  {
+    d_eqChanges.push_back(t);
+  }
+}
+
+void TermDb::resetTermIndices()
 {
-  d_op_nonred_count.clear();
+  // The term indices of an operator can be kept if its terms were neither
+  // retracted nor extended, and if no representative of its terms and their
+  // arguments changed. The latter is the case unless the equivalence class
+  // of such a representative was merged into another one, or a term that was
+  // not indexed since it was not in the equality engine entered it.
+  const bool incremental =
+      options::termDbIncremental() && !options::ufHo()
+      && options::termDbMode() == options::TermDbMode::ALL && d_consistent_ee
+      && d_generation > 0 && d_computedGeneration.get() == d_generation;
+  d_computedGeneration = ++d_generation;
   d_arg_reps.clear();
-  d_func_map_trie.clear();
-  d_func_map_eqc_trie.clear();
-  d_func_map_rel_dom.clear();
+  if (!incremental)
+  {
+    d_op_nonred_count.clear();
+    d_func_map_trie.clear();
+    d_func_map_eqc_trie.clear();
+    d_func_map_rel_dom.clear();
+    d_opTermsIndexed.clear();
+    d_repUsers.clear();
+    d_eqChanges.clear();
+    return;
+  }
+  std::unordered_set<Node, NodeHashFunction> changed;
+  for (const Node& r : d_eqChanges)
+  {
+    auto it = d_repUsers.find(r);
+    if (it != d_repUsers.end())
+    {
+      changed.insert(it->second.begin(), it->second.end());
+      d_repUsers.erase(it);
+    }
+  }
+  d_eqChanges.clear();
+  for (const std::pair<const Node, size_t>& ot : d_opTermsIndexed)
+  {
+    if (getNumGroundTerms(ot.first) != ot.second)
+    {
+      changed.insert(ot.first);
+    }
+  }
+  for (const Node& f : changed)
+  {
+    d_op_nonred_count.erase(f);
+    d_func_map_trie.erase(f);
+    d_func_map_eqc_trie.erase(f);
+    d_func_map_rel_dom.erase(f);
+    d_opTermsIndexed.erase(f);
+  }
+  Trace("term-db-incremental")
+      << "TermDb::reset : keep the term indices of " << d_opTermsIndexed.size()
+      << " operators, drop " << changed.size() << std::endl;
+}
+
+bool TermDb::reset(Theory::Effort effort)
+{
+  resetTermIndices();
   d_consistent_ee = true;
 
   eq::EqualityEngine* ee = d_qstate.getEqualityEngine();
@@ -1302,7 +1417,7 @@ TNodeTrie* TermDb::getTermArgTrie(Node eqc, Node f)
     }
     else
     {
-      std::map<TNode, TNodeTrie>::iterator itute =
+      TNodeTrie::ChildMap::iterator itute =
           itut->second.d_data.find(eqc);
       if (itute != itut->second.d_data.end())
       {
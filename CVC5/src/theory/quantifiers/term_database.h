@@ -83,6 +83,14 @@ class TermDb : public QuantifiersUtil {
   void presolve();
   /** reset (calculate which terms are active) */
   bool reset(Theory::Effort effort) override;
+  /**
+   * Notification that the equivalence class of t2 was merged into the one of
+   * t1 in the master equality engine.
+   */
+  void eqNotifyMerge(TNode t1, TNode t2);
+  /** Notification that t is a new equivalence class of the master equality
+   * engine. */
+  void eqNotifyNewClass(TNode t);
   /** register quantified formula */
   void registerQuantifier(Node q) override;
   /** identify */
@@ -328,6 +336,33 @@ class TermDb : public QuantifiersUtil {
   std::map<Node, TNodeTrie> d_func_map_eqc_trie;
   /** mapping from operators to their representative relevant domains */
   std::map< Node, std::map< unsigned, std::vector< Node > > > d_func_map_rel_dom;
+  //------------------------------incremental term indexing
+  /** number of resets of the term indices */
+  size_t d_generation;
+  /** the value of d_generation at the last reset, reverts to a smaller value
+   * when the SAT context is backtracked below the level of the last reset, in
+   * which case the term indices may depend on retracted equalities */
+  context::CDO<size_t> d_computedGeneration;
+  /**
+   * The representatives merged away and the terms that became equivalence
+   * classes since the last reset, recorded only while the term indices can
+   * be kept.
+   */
+  std::vector<Node> d_eqChanges;
+  /** the number of terms of each operator when its term index was computed */
+  std::map<Node, size_t> d_opTermsIndexed;
+  /**
+   * Map from representatives to the operators whose term indices were
+   * computed with terms or arguments in their equivalence classes, or with
+   * terms not in the equality engine, which are their own representatives.
+   */
+  std::unordered_map<Node, std::vector<Node>, NodeHashFunction> d_repUsers;
+  /** Reset the term indices, keeping those of the operators unaffected by
+   * the changes since the last reset if --term-db-incremental is enabled. */
+  void resetTermIndices();
+  /** Record that the term indices of operator f depend on representative r */
+  void addRepresentativeUser(TNode r, TNode f);
+  //------------------------------end incremental term indexing
   /** has map */
   std::map< Node, bool > d_has_map;
   /** map from reps to a term in eqc in d_has_map */
@@ -6,6 +6,7 @@
 #include <map>
 #include <numeric>
 #include <sstream>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -30,15 +31,15 @@ namespace theory {
 namespace quantifiers {
 /**A term producer based on the term database and the current equivalent
  * classes, i.e. if 2 terms belong to the same equivalents class, only one of
- * them will be produced.*/
+ * them will be produced. The terms are taken from a cache shared with the
+ * producers of the other quantifiers.*/
 class BasicTermProducer : public ITermProducer
 {
  public:
-  BasicTermProducer(Node quantifier, QuantifiersState& qs, TermDb* td)
+  BasicTermProducer(Node quantifier, GroundTermCache* groundTerms)
       : d_quantifier(quantifier),
-        d_qs(qs),
-        d_typeCache(quantifier[0].getNumChildren()),
-        d_tdb(td)
+        d_groundTerms(groundTerms),
+        d_terms(quantifier[0].getNumChildren(), nullptr)
   {
   }
 
@@ -52,14 +53,10 @@ class BasicTermProducer : public ITermProducer
 
  protected:
   const Node d_quantifier;
-  /**  a list of terms for each type */
-  std::map<TypeNode, std::vector<Node>> d_termDbList;
-  /** Reference to quantifiers state */
-  QuantifiersState& d_qs;
-  /** type for each variable */
-  std::vector<TypeNode> d_typeCache;
-  /** Pointer to term database */
-  TermDb* d_tdb;
+  /** the ground terms of the current round */
+  GroundTermCache* d_groundTerms;
+  /** the list of terms for each variable, owned by d_groundTerms */
+  std::vector<const std::vector<Node>*> d_terms;
 };
 
 /**
@@ -195,11 +192,60 @@ TermTupleEnumeratorGlobal::TermTupleEnumeratorGlobal()
           "theory::quantifiers::fs::timers::featurizeTimer")),
       d_learningCounter(smtStatisticsRegistry().registerInt(
           "theory::quantifiers::fs::mlCounter", 0)),
+      d_mlCacheHits(smtStatisticsRegistry().registerInt(
+          "theory::quantifiers::fs::mlCacheHits", 0)),
+      d_astarMaxFrontier(smtStatisticsRegistry().registerInt(
+          "theory::quantifiers::fs::astar::maxFrontier", 0)),
+      d_astarEvictions(smtStatisticsRegistry().registerInt(
+          "theory::quantifiers::fs::astar::evictions", 0)),
+      d_disabledHits(smtStatisticsRegistry().registerInt(
+          "theory::quantifiers::fs::disabledHits", 0)),
+      d_groundTermsTimer(smtStatisticsRegistry().registerTimer(
+          "theory::quantifiers::fs::timers::groundTermsTimer")),
+      d_groundTermsHits(smtStatisticsRegistry().registerInt(
+          "theory::quantifiers::fs::groundTermsHits", 0)),
       d_mt(options::fullSaturateRndSeed())
 {
 }
 
+void TermTupleEnumeratorGlobal::prunePredictionCache(size_t maxAge)
+{
+  if (maxAge == 0 || d_round <= maxAge)
+  {
+    return;
+  }
+  for (auto qit = d_predictionCache.begin(); qit != d_predictionCache.end();)
+  {
+    bool empty = true;
+    for (auto& cache : qit->second)
+    {
+      for (auto it = cache.begin(); it != cache.end();)
+      {
+        if (d_round - it->second.d_lastUsed > maxAge)
+        {
+          it = cache.erase(it);
+        }
+        else
+        {
+          ++it;
+        }
+      }
+      empty = empty && cache.empty();
+    }
+    qit = empty ? d_predictionCache.erase(qit) : std::next(qit);
+  }
+}
+
 void TermTupleEnumeratorBase::init()
+{
+  if (prepare())
+  {
+    d_env->d_termProducer->initialize();
+  }
+  start();
+}
+
+bool TermTupleEnumeratorBase::prepare()
 {
   Trace("inst-alg-rd") << "Initializing enumeration " << d_quantifier
                        << std::endl;
@@ -207,11 +253,16 @@ void TermTupleEnumeratorBase::init()
 
   if (!d_hasNext)
   {
-    return;
+    return false;
   }
 
   bool anyTerms = false;  // keep track of whether any terms where added
   const bool logging = options::qlogging() || d_global->d_ml != nullptr;
+  if (logging)
+  {
+    d_loggerHadQuantifier =
+        QuantifierLogger::s_logger.hasQuantifier(d_quantifier);
+  }
 
   // prepare a sequence of terms for each quantified variable
   // additionally initialize the cache for variable types
@@ -235,18 +286,14 @@ void TermTupleEnumeratorBase::init()
         const auto term =
             d_env->d_termProducer->getTermOriginal(variableIx, termIx);
         const bool isRelevant = ContainsKey(relevant, term);
-        anyTerms = QuantifierLogger::s_logger.registerCandidate(
-                       d_quantifier, variableIx, term, isRelevant)
-                   || anyTerms;
+        anyTerms = registerCandidate(variableIx, term, isRelevant) || anyTerms;
       }
       if (termsSize == 0 && d_env->d_fullEffort)
       {
         const TypeNode typeNode = d_quantifier[0][variableIx].getType();
         const auto term = d_global->d_treg->getTermForType(typeNode);
         const bool isRelevant = ContainsKey(relevant, term);
-        anyTerms = QuantifierLogger::s_logger.registerCandidate(
-                       d_quantifier, variableIx, term, isRelevant)
-                   || anyTerms;
+        anyTerms = registerCandidate(variableIx, term, isRelevant) || anyTerms;
       }
     }
     Trace("inst-alg-rd") << "Variable " << variableIx << " has " << termsSize
@@ -254,18 +301,61 @@ void TermTupleEnumeratorBase::init()
     if (termsSize == 0 && !d_env->d_fullEffort)
     {
       d_hasNext = false;
-      return;  // give up on an empty domain
+      return false;  // give up on an empty domain
     }
     d_termsSizes.push_back(termsSize);
   }
 
   d_termIndex.resize(d_variableCount, 0);
-  d_env->d_termProducer->initialize();
+  // the predictions for the terms do not depend on the current phase, so the
+  // phase may be increased before the term producer is initialized
   if (logging && anyTerms)
   {
     QuantifierLogger::s_logger.increasePhase(d_quantifier);
+    d_increasedPhase = true;
+  }
+  return true;
+}
+
+bool TermTupleEnumeratorBase::registerCandidate(size_t variableIx,
+                                                Node term,
+                                                bool relevant)
+{
+  if (!QuantifierLogger::s_logger.registerCandidate(
+          d_quantifier, variableIx, term, relevant))
+  {
+    return false;
+  }
+  d_registeredCandidates.push_back({variableIx, term});
+  return true;
+}
+
+void TermTupleEnumeratorBase::cancel()
+{
+  if (d_registeredCandidates.empty() && !d_increasedPhase
+      && d_loggerHadQuantifier)
+  {
+    return;
+  }
+  QuantifierLogger::s_logger.unregisterCandidates(d_quantifier,
+                                                  d_registeredCandidates,
+                                                  d_loggerHadQuantifier,
+                                                  d_increasedPhase);
+  d_registeredCandidates.clear();
+  d_increasedPhase = false;
+  d_loggerHadQuantifier = true;
+}
+
+void TermTupleEnumeratorBase::start()
+{
+  // the registrations of prepare are final from now on
+  d_registeredCandidates.clear();
+  d_increasedPhase = false;
+  d_loggerHadQuantifier = true;
+  if (d_hasNext)
+  {
+    initializeAttempts();
   }
-  initializeAttempts();
 }
 
 bool TermTupleEnumeratorBase::hasNext()
@@ -390,10 +480,18 @@ bool TermTupleEnumeratorBase::nextCombination()
     {
       return false;  // ran out of combinations
     }
+    // on a hit, d_changePrefix becomes the shortest prefix that needs to
+    // change to escape the disabled combinations, so the next attempt jumps
+    // over all the combinations sharing that prefix
     if (!d_disabledCombinations.find(d_termIndex, d_changePrefix))
     {
       return true;  // current combination vetted by disabled combinations
     }
+    ++d_global->d_disabledHits;
+    if (d_changePrefix == 0)
+    {
+      return false;  // all combinations are disabled
+    }
   }
 }
 
@@ -530,41 +628,48 @@ void RandomizeProducer::randomizePermutation(size_t varIx)
   }
 }
 
-size_t BasicTermProducer::prepareTerms(size_t variableIx)
+const std::vector<Node>& GroundTermCache::getTerms(TypeNode type)
 {
-  Assert(variableIx < d_typeCache.size())
-      << "mismatch " << variableIx << ":" << d_typeCache.size() << "\n";
-  const TypeNode type_node = d_quantifier[0][variableIx].getType();
-  d_typeCache[variableIx] = type_node;
-  if (!ContainsKey(d_termDbList, type_node))
+  const auto it = d_terms.find(type);
+  if (it != d_terms.end())
+  {
+    ++(d_global->d_groundTermsHits);
+    return it->second;
+  }
+  TimerStat::CodeTimer codeTimer(d_global->d_groundTermsTimer);
+  std::vector<Node>& terms = d_terms[type];
+  const size_t ground_terms_count = d_tdb->getNumTypeGroundTerms(type);
+  std::unordered_set<Node, NodeHashFunction> repsFound;
+  for (size_t j = 0; j < ground_terms_count; j++)
   {
-    const size_t ground_terms_count = d_tdb->getNumTypeGroundTerms(type_node);
-    std::map<Node, Node> repsFound;
-    for (size_t j = 0; j < ground_terms_count; j++)
+    Node gt = d_tdb->getTypeGroundTerm(type, j);
+    if (!options::cegqi() || !quantifiers::TermUtil::hasInstConstAttr(gt))
     {
-      Node gt = d_tdb->getTypeGroundTerm(type_node, j);
-      if (!options::cegqi() || !quantifiers::TermUtil::hasInstConstAttr(gt))
+      if (repsFound.insert(d_qs.getRepresentative(gt)).second)
       {
-        Node rep = d_qs.getRepresentative(gt);
-        if (repsFound.find(rep) == repsFound.end())
-        {
-          repsFound[rep] = gt;
-          d_termDbList[type_node].push_back(gt);
-        }
+        terms.push_back(gt);
       }
     }
   }
+  return terms;
+}
 
+size_t BasicTermProducer::prepareTerms(size_t variableIx)
+{
+  Assert(variableIx < d_terms.size())
+      << "mismatch " << variableIx << ":" << d_terms.size() << "\n";
+  const TypeNode type_node = d_quantifier[0][variableIx].getType();
+  d_terms[variableIx] = &d_groundTerms->getTerms(type_node);
   Trace("inst-alg-rd") << "Instantiation Terms for child " << variableIx << ": "
-                       << d_termDbList[type_node] << std::endl;
-  return d_termDbList[type_node].size();
+                       << *d_terms[variableIx] << std::endl;
+  return d_terms[variableIx]->size();
 }
 
 Node BasicTermProducer::getTerm(size_t variableIx, size_t term_index)
 {
-  const TypeNode type_node = d_typeCache[variableIx];
-  Assert(term_index < d_termDbList[type_node].size());
-  return d_termDbList[type_node][term_index];
+  Assert(d_terms[variableIx] != nullptr);
+  Assert(term_index < d_terms[variableIx]->size());
+  return (*d_terms[variableIx])[term_index];
 }
 
 /**
@@ -608,9 +713,9 @@ class PoolTermProducer : public ITermProducer
   /**  a list of terms for each id */
   std::map<size_t, std::vector<Node>> d_poolList;
 };
-ITermProducer* mkTermProducer(Node quantifier, QuantifiersState& qs, TermDb* td)
+ITermProducer* mkTermProducer(Node quantifier, GroundTermCache* groundTerms)
 {
-  return new BasicTermProducer(quantifier, qs, td);
+  return new BasicTermProducer(quantifier, groundTerms);
 }
 ITermProducer* mkTermProducerRd(Node q, RelevantDomain* rd)
 {
@@ -2,6 +2,7 @@
 #define CVC5__THEORY__QUANTIFIERS__TERM_TUPLE_ENUMERATOR_H
 
 #include <random>
+#include <unordered_map>
 #include <vector>
 
 #include "expr/node.h"
@@ -54,6 +55,17 @@ class TermTupleEnumeratorInterface
  public:
   /** Initialize the enumerator. */
   virtual void init() = 0;
+  /** Initialize the enumerator in two steps, between which the caller
+   * initializes the term producer, so that the producers of several
+   * enumerators can be initialized together. Calling prepare, initializing
+   * the term producer if prepare returns true, and start is the same as
+   * calling init. */
+  virtual bool prepare() = 0;
+  virtual void start() = 0;
+  /** Undo the registration of candidate terms in the quantifier logger by
+   * prepare, for an enumeration that is prepared but dropped without being
+   * started. */
+  virtual void cancel() = 0;
   /** Test if there are any more combinations. */
   virtual bool hasNext() = 0;
   /** Obtain the next combination, meaningful only if hasNext Returns true. */
@@ -61,6 +73,11 @@ class TermTupleEnumeratorInterface
   /** Record which of the terms obtained by the last call of next should not be
    * explored again. */
   virtual void failureReason(const std::vector<bool>& mask) = 0;
+  /** The number of candidate terms of each variable, once started. */
+  virtual const std::vector<size_t>& getCandidateCounts() const = 0;
+  /** The positions, in the order of the term producer, of the terms obtained
+   * by the last call of next. */
+  virtual const std::vector<size_t>& getCurrentIndices() const = 0;
   virtual ~TermTupleEnumeratorInterface() = default;
 };
 
@@ -70,6 +87,32 @@ struct QuantifierInfo
   std::vector<std::map<Node, TermCandidateInfo> > d_candidateInfos;
 };
 
+/** A score of a candidate term predicted by TermTupleEnumeratorGlobal::d_ml,
+ * together with the features of the term that change between rounds. */
+struct CachedPrediction
+{
+  size_t d_age, d_phase;
+  bool d_relevant;
+  size_t d_tried;
+  double d_score;
+  /** the round in which the score was predicted */
+  size_t d_round;
+  /** the last round in which the score was used */
+  size_t d_lastUsed;
+  bool matches(const TermCandidateInfo& info) const
+  {
+    return d_age == info.d_age && d_phase == info.d_phase
+           && d_relevant == info.d_relevant && d_tried == info.d_tried;
+  }
+};
+
+/** Cached predictions for each quantifier, variable and candidate term. */
+typedef std::unordered_map<
+    Node,
+    std::vector<std::unordered_map<Node, CachedPrediction, NodeHashFunction>>,
+    NodeHashFunction>
+    PredictionCache;
+
 struct TermTupleEnumeratorGlobal
 {
   TermTupleEnumeratorGlobal();
@@ -77,12 +120,61 @@ struct TermTupleEnumeratorGlobal
   TermRegistry* d_treg;
   PredictorInterface* d_ml;
   PredictorInterface* d_tuplePredictor;
+  /** features of terms and quantifiers, shared across rounds */
+  FeatureCache d_featureCache;
+  /** scores of terms, shared across rounds (see --ml-rescore-period) */
+  PredictionCache d_predictionCache;
+  /** Drop the cached scores not used in the last maxAge rounds, 0 keeps all
+   * of them. */
+  void prunePredictionCache(size_t maxAge);
+  /** number of full saturation rounds so far */
+  size_t d_round = 0;
+  /** whether the times of the ML producers are measured for --fs-profile */
+  bool d_profile = false;
 
   TimerStat d_learningTimer, d_mlTimer, d_featurizeTimer;
-  IntStat d_learningCounter;
+  IntStat d_learningCounter, d_mlCacheHits;
+  /** largest A* frontier and number of tuples dropped from it by the beam */
+  IntStat d_astarMaxFrontier, d_astarEvictions;
+  /** number of combinations skipped as disabled by earlier failures */
+  IntStat d_disabledHits;
+  /** time spent collecting ground terms and the number of times they were
+   * reused from GroundTermCache */
+  TimerStat d_groundTermsTimer;
+  IntStat d_groundTermsHits;
   std::mt19937 d_mt;
 };
 
+/** Ground terms of the term database for each type, with one term for each
+ * equivalence class. The lists are computed on demand and shared by the term
+ * producers of all quantifiers in a round, the owner is responsible for
+ * calling clear whenever the equivalence classes may have changed. */
+class GroundTermCache
+{
+ public:
+  GroundTermCache(QuantifiersState& qs,
+                  TermDb* td,
+                  TermTupleEnumeratorGlobal* global)
+      : d_qs(qs), d_tdb(td), d_global(global)
+  {
+  }
+  /** The ground terms of the given type, the reference stays valid until the
+   * next call of clear. */
+  const std::vector<Node>& getTerms(TypeNode type);
+  /** Forget all lists. */
+  void clear() { d_terms.clear(); }
+
+ private:
+  /** Reference to quantifiers state */
+  QuantifiersState& d_qs;
+  /** Pointer to term database */
+  TermDb* d_tdb;
+  /** statistics */
+  TermTupleEnumeratorGlobal* d_global;
+  /**  a list of terms for each type */
+  std::map<TypeNode, std::vector<Node>> d_terms;
+};
+
 /** A struct bundling up parameters for term tuple enumerator.*/
 struct TermTupleEnumeratorEnv
 {
@@ -134,9 +226,7 @@ TermTupleEnumeratorInterface* mkStagedTermTupleEnumerator(
 /** Make term pool enumerator */
 ITermProducer* mkPoolTermProducer(Node quantifier, TermPools* tp, Node pool);
 
-ITermProducer* mkTermProducer(Node quantifier,
-                              QuantifiersState& qs,
-                              TermDb* td);
+ITermProducer* mkTermProducer(Node quantifier, GroundTermCache* groundTerms);
 
 ITermProducer* mkTermProducerRd(Node quantifier, RelevantDomain* rd);
 ITermProducer* mkTermProducerRandomize(ITermProducer* producer,
@@ -165,9 +255,20 @@ class TermTupleEnumeratorBase : public TermTupleEnumeratorInterface
 
   // implementation of the TermTupleEnumeratorInterface
   virtual void init() override;
+  virtual bool prepare() override;
+  virtual void start() override;
+  virtual void cancel() override;
   virtual bool hasNext() override;
   virtual void next(/*out*/ std::vector<Node>& terms) override;
   virtual void failureReason(const std::vector<bool>& mask) override;
+  virtual const std::vector<size_t>& getCandidateCounts() const override
+  {
+    return d_termsSizes;
+  }
+  virtual const std::vector<size_t>& getCurrentIndices() const override
+  {
+    return d_termIndex;
+  }
   // end of implementation of the TermTupleEnumeratorInterface
 
  protected:
@@ -189,6 +290,17 @@ class TermTupleEnumeratorBase : public TermTupleEnumeratorInterface
   /** a data structure storing disabled combinations of terms */
   IndexTrie d_disabledCombinations;
 
+  /** the candidates registered in the quantifier logger by prepare, as
+   * variable indices and terms */
+  std::vector<std::pair<size_t, Node>> d_registeredCandidates;
+  /** whether the quantifier logger knew the quantifier before prepare */
+  bool d_loggerHadQuantifier = true;
+  /** whether prepare increased the phase of the quantifier */
+  bool d_increasedPhase = false;
+  /** Register a candidate term of a variable in the quantifier logger,
+   * returns whether it is new. */
+  bool registerCandidate(size_t variableIx, Node term, bool relevant);
+
   /**becomes false once the enumerator runs out of options*/
   bool d_hasNext;
   /** the length of the prefix that has to be changed in the next
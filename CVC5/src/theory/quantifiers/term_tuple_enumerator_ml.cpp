@@ -1,7 +1,8 @@
 #include "theory/quantifiers/term_tuple_enumerator_ml.h"
 
 #include <algorithm>
-#include <unordered_set>
+#include <limits>
+#include <unordered_map>
 
 #include "base/map_util.h"
 #include "base/output.h"
@@ -9,6 +10,7 @@
 #include "smt/smt_statistics_registry.h"
 #include "theory/quantifiers/featurize.h"
 #include "theory/quantifiers/index_trie.h"
+#include "theory/quantifiers/inst_profiler.h"
 #include "theory/quantifiers/quant_module.h"
 #include "theory/quantifiers/quantifier_logger.h"
 #include "theory/quantifiers/relevant_domain.h"
@@ -29,31 +31,124 @@ MLProducer::MLProducer(TermTupleEnumeratorGlobal* global,
       d_env(env),
       d_producer(producer),
       d_quantifier(quantifier),
+      d_termCounts(d_quantifier[0].getNumChildren(), 0),
       d_permutations(d_quantifier[0].getNumChildren()),
+      d_heaps(d_quantifier[0].getNumChildren()),
       d_predictions(d_quantifier[0].getNumChildren())
 {
 }
 
+namespace {
+/** Comparison of terms in the heap of MLProducer, the top is the term with
+ * the highest score and among those the one with the lowest index. */
+struct ScoreLess
+{
+  const std::vector<double>& d_scores;
+  bool operator()(size_t a, size_t b) const
+  {
+    return d_scores[a] < d_scores[b] || (d_scores[a] == d_scores[b] && a > b);
+  }
+};
+}  // namespace
+
 size_t MLProducer::prepareTerms(size_t variableIndex)
 {
   Assert(variableIndex < d_permutations.size());
   // prepare terms of the producer being decorated
   const auto termCount = d_producer->prepareTerms(variableIndex);
-  // set of the permutation for this variable, initially as identity
-  auto& permutation = d_permutations[variableIndex];
-  permutation.resize(termCount, 0);
-  std::iota(permutation.begin(), permutation.end(), 0);
+  d_termCounts[variableIndex] = termCount;
+  // nothing is ordered yet, all terms wait in the heap
+  d_permutations[variableIndex].clear();
+  auto& heap = d_heaps[variableIndex];
+  heap.resize(termCount, 0);
+  std::iota(heap.begin(), heap.end(), 0);
   return termCount;
 }
 
+void MLProducer::extendOrder(size_t variableIx, size_t length)
+{
+  auto& permutation = d_permutations[variableIx];
+  auto& heap = d_heaps[variableIx];
+  const ScoreLess less{d_predictions[variableIx]};
+  Assert(length <= permutation.size() + heap.size());
+  while (permutation.size() < length)
+  {
+    std::pop_heap(heap.begin(), heap.end(), less);
+    permutation.push_back(heap.back());
+    heap.pop_back();
+  }
+}
+
 void MLProducer::runPrediction()
 {
   TimerStat::CodeTimer codeTimer(d_global->d_learningTimer);
-  // set of features for quantifier
-  Featurize quantifierFeatures(true);
+  featurizeCandidates();
+  {  // run prediction for all the terms at once
+    TimerStat::CodeTimer predictTimer(d_global->d_mlTimer);
+    scoreCandidates();
+  }
+  finishPrediction();
+}
+
+void MLProducer::predictAll(const std::vector<MLProducer*>& producers,
+                            size_t threadCount)
+{
+  if (producers.empty())
+  {
+    return;
+  }
+  TermTupleEnumeratorGlobal* global = producers[0]->d_global;
+  TimerStat::CodeTimer codeTimer(global->d_learningTimer);
+  {
+    // features of the terms of all quantifiers, shared by the quantifiers
+    TimerStat::CodeTimer featurizeTimer(global->d_featurizeTimer);
+    std::vector<Node> terms;
+    for (const MLProducer* producer : producers)
+    {
+      Assert(!producer->d_initialized);
+      for (size_t variableIx = 0; variableIx < producer->d_termCounts.size();
+           variableIx++)
+      {
+        for (size_t termIx = 0; termIx < producer->d_termCounts[variableIx];
+             termIx++)
+        {
+          terms.push_back(producer->d_producer->getTerm(variableIx, termIx));
+        }
+      }
+    }
+    global->d_featureCache.prefetchTermFeatures(terms, threadCount);
+  }
+  for (MLProducer* producer : producers)
+  {
+    producer->featurizeCandidates();
+  }
+  {
+    TimerStat::CodeTimer predictTimer(global->d_mlTimer);
+    const int threads =
+        global->d_ml->isThreadSafe() ? std::max<size_t>(threadCount, 1) : 1;
+#pragma omp parallel for num_threads(threads) schedule(dynamic)
+    for (size_t i = 0; i < producers.size(); i++)
+    {
+      producers[i]->scoreCandidates();
+    }
+  }
+  for (MLProducer* producer : producers)
+  {
+    producer->finishPrediction();
+    producer->d_initialized = true;
+  }
+}
+
+void MLProducer::featurizeCandidates()
+{
+  InstProfiler::Timer profileTimer(d_global->d_profile ? &d_featurizeTime
+                                                      : nullptr);
+  // features of the quantifier, calculated once per quantifier
+  const QuantifierFeatures* quantifierFeatures;
   {
     TimerStat::CodeTimer codeTimer1(d_global->d_featurizeTimer);
-    quantifierFeatures.count(d_quantifier);
+    quantifierFeatures =
+        &d_global->d_featureCache.getQuantifierFeatures(d_quantifier);
   }
 
   //  feature vector or that we are using for all terms
@@ -65,24 +160,86 @@ void MLProducer::runPrediction()
       << " features but the model has " << d_global->d_ml->numberOfFeatures()
       << std::endl;
   // featurize  current quantifier
-  featurizeQuantifier(&features, quantifierFeatures);
+  featurizeQuantifier(&features, *quantifierFeatures);
 
-  // run prediction for individual variables
+  // featurize the terms of all variables into a single sparse matrix, so that
+  // the whole quantifier is scored by one call of the predictor, which is a
+  // single round trip for the TCP predictor; terms with a cached score are
+  // skipped
   const auto variableCount(d_quantifier[0].getNumChildren());
   for (size_t variableIx = 0; variableIx < variableCount; variableIx++)
   {
-    runPrediction(quantifierFeatures, features, variableIx);
+    featurizeTerms(
+        *quantifierFeatures, features, variableIx, d_rows, d_rowTerms);
   }
 }
 
-void MLProducer::runPrediction(const Featurize& quantifierFeatures,
-                               FeatureVector& features,
-                               size_t variableIx)
+void MLProducer::scoreCandidates()
 {
-  auto& permutation = d_permutations[variableIx];
-  const auto termCount = permutation.size();
+  InstProfiler::Timer profileTimer(d_global->d_profile ? &d_predictTime
+                                                      : nullptr);
+  d_rowScores.resize(d_rows.rowCount());
+  d_rowScoresValid = true;
+  if (d_rows.rowCount() > 0)
+  {
+    d_rowScoresValid = d_global->d_ml->predictBatchCSR(d_rows.rowStarts(),
+                                                       d_rows.indices(),
+                                                       d_rows.values(),
+                                                       d_rows.rowCount(),
+                                                       d_rowScores.data());
+  }
+}
+
+void MLProducer::finishPrediction()
+{
+  // distribute the predictions to the terms and remember them, unless the
+  // predictor failed and the scores are only placeholders
+  const bool useCache = options::mlRescorePeriod() > 0 && d_rowScoresValid;
+  if (!d_rowTerms.empty())
+  {
+    const auto& qinfo =
+        QuantifierLogger::s_logger.getQuantifierInfo(d_quantifier);
+    for (size_t row = 0; row < d_rowTerms.size(); row++)
+    {
+      const auto [variableIx, termIx] = d_rowTerms[row];
+      d_predictions[variableIx][termIx] = d_rowScores[row];
+      if (useCache)
+      {
+        const auto term = d_producer->getTerm(variableIx, termIx);
+        const auto& termInfo = qinfo.d_infos[variableIx].at(term);
+        d_global->d_predictionCache[d_quantifier][variableIx][term] =
+            CachedPrediction{termInfo.d_age,
+                             termInfo.d_phase,
+                             termInfo.d_relevant,
+                             termInfo.d_tried,
+                             d_rowScores[row],
+                             d_global->d_round,
+                             d_global->d_round};
+      }
+    }
+  }
+  // the rows are not needed anymore
+  d_rows = FeatureMatrix();
+  d_rowTerms.clear();
+  d_rowScores.clear();
+  for (size_t variableIx = 0; variableIx < d_termCounts.size(); variableIx++)
+  {
+    if (d_termCounts[variableIx] > 0)
+    {
+      orderTerms(variableIx);
+    }
+  }
+}
 
-  if (d_global->d_ml == nullptr || termCount == 0)
+void MLProducer::featurizeTerms(
+    const QuantifierFeatures& quantifierFeatures,
+    FeatureVector& features,
+    size_t variableIx,
+    FeatureMatrix& rows,
+    std::vector<std::pair<size_t, size_t>>& rowTerms)
+{
+  const auto termCount = d_termCounts[variableIx];
+  if (termCount == 0)
   {
     return;
   }
@@ -93,52 +250,99 @@ void MLProducer::runPrediction(const Featurize& quantifierFeatures,
   ++d_global->d_learningCounter;
   Trace("inst-alg-rd") << "Predicting terms for var" << variableIx << std::endl;
 
+  // scores from previous rounds, see --ml-rescore-period
+  const size_t period = std::max(options::mlRescorePeriod(), 0);
+  std::unordered_map<Node, CachedPrediction, NodeHashFunction>* cache =
+      nullptr;
+  if (period > 0)
+  {
+    auto& quantifierCache = d_global->d_predictionCache[d_quantifier];
+    quantifierCache.resize(d_quantifier[0].getNumChildren());
+    cache = &quantifierCache[variableIx];
+  }
+
   const auto& tsinfo = qinfo.d_infos[variableIx];
   auto& predictions = d_predictions[variableIx];
   predictions.resize(termCount);
-
   for (size_t termIx = 0; termIx < termCount; termIx++)
   {
-    // add features for the term
     const auto term = d_producer->getTerm(variableIx, termIx);
+    const auto& termInfo = tsinfo.at(term);
+    if (cache != nullptr)
+    {
+      const auto it = cache->find(term);
+      const bool fresh =
+          it != cache->end()
+          && (it->second.matches(termInfo)
+              || (period > 1
+                  && d_global->d_round - it->second.d_round < period));
+      if (fresh)
+      {
+        it->second.d_lastUsed = d_global->d_round;
+        predictions[termIx] = it->second.d_score;
+        ++d_global->d_mlCacheHits;
+        continue;
+      }
+    }
+    // add features for the term
     features.push();
     {
-      const auto termInfo = tsinfo.at(term);
       TimerStat::CodeTimer codeTimer1(d_global->d_featurizeTimer);
-      featurizeTerm(&features, term, variableIx, termInfo, quantifierFeatures);
+      featurizeTerm(&features,
+                    d_global->d_featureCache.getTermFeatures(term),
+                    variableIx,
+                    termInfo,
+                    quantifierFeatures);
     }
     Assert(features.isFull());
-
-    {  // run prediction
-      TimerStat::CodeTimer predictTimer(d_global->d_mlTimer);
-      const auto prediction = d_global->d_ml->predict(features.rawValues());
-      predictions[termIx] = options::mlThreshold.wasSetByUser()
-                                ? (prediction > options::mlThreshold() ? 1 : 0)
-                                : prediction;
-    }
-
+    rows.addRow(features);
+    rowTerms.push_back({variableIx, termIx});
     Trace("inst-alg-rd") << term << " features : " << features << std::endl;
-    Trace("inst-alg-rd") << "Prediction " << term << " : "
-                         << predictions[termIx] << std::endl;
     features.pop();  // remove current term from the feature vector
   }
+}
 
-  // create a permutation that corresponds to sorting the terms by the predicted
-  // score, assuming that the permutation was initially the identity
-  Assert(permutation.size() == termCount);
-  std::stable_sort(permutation.begin(),
-                   permutation.end(),
-                   [predictions](size_t a, size_t b) {
-                     return predictions[a] > predictions[b];
-                   });
-  Trace("inst-alg-rd") << "Learned order : [";
-  for (size_t i = 0; i < permutation.size(); i++)
+void MLProducer::orderTerms(size_t variableIx)
+{
+  auto& predictions = d_predictions[variableIx];
+  const auto termCount = d_termCounts[variableIx];
+  if (options::mlThreshold.wasSetByUser())
   {
-    Trace("inst-alg-rd") << (i ? ", " : "")
-                         << d_producer->getTerm(variableIx, permutation[i])
-                         << "@" << predictions[permutation[i]];
+    const double threshold = options::mlThreshold();
+    for (auto& prediction : predictions)
+    {
+      prediction = prediction > threshold ? 1 : 0;
+    }
+  }
+  if (Trace.isOn("inst-alg-rd"))
+  {
+    for (size_t termIx = 0; termIx < termCount; termIx++)
+    {
+      Trace("inst-alg-rd") << "Prediction "
+                           << d_producer->getTerm(variableIx, termIx) << " : "
+                           << predictions[termIx] << std::endl;
+    }
+  }
+
+  // arrange the terms in a heap by the predicted score, the permutation is
+  // then materialized on demand by extendOrder
+  Assert(predictions.size() == termCount);
+  Assert(d_permutations[variableIx].empty());
+  auto& heap = d_heaps[variableIx];
+  std::make_heap(heap.begin(), heap.end(), ScoreLess{predictions});
+  if (Trace.isOn("inst-alg-rd"))
+  {
+    extendOrder(variableIx, termCount);
+    const auto& permutation = d_permutations[variableIx];
+    Trace("inst-alg-rd") << "Learned order : [";
+    for (size_t i = 0; i < permutation.size(); i++)
+    {
+      Trace("inst-alg-rd") << (i ? ", " : "")
+                           << d_producer->getTerm(variableIx, permutation[i])
+                           << "@" << predictions[permutation[i]];
+    }
+    Trace("inst-alg-rd") << "]" << std::endl;
   }
-  Trace("inst-alg-rd") << "]" << std::endl;
 }
 
 MLProducer* mkTermProducerML(TermTupleEnumeratorGlobal* global,
@@ -149,6 +353,24 @@ MLProducer* mkTermProducerML(TermTupleEnumeratorGlobal* global,
   return new MLProducer(global, env, producer, quantifier);
 }
 
+/**
+ * Best-first enumeration of term tuples. Each tuple other than the all-zero
+ * one is generated only from the tuple obtained by decreasing its last nonzero
+ * digit, i.e., successors of a tuple only increase digits at or after its last
+ * nonzero digit. So no tuple is generated twice and no visited set is needed.
+ * For scores monotone in each digit the order of enumeration is the same as
+ * with all successors since the parent is never worse than its children.
+ *
+ * Tuples of the frontier are stored in a flat arena, d_variableCount entries
+ * per slot. With --fs-astar-beam=N the frontier is cut down to its best N
+ * tuples whenever it reaches twice that size, which makes the enumeration
+ * incomplete but bounds the memory.
+ *
+ * The successors of a popped tuple are scored together, with a tuple
+ * predictor by a single batch call. Feature vectors of tuples are assembled
+ * from the features of the quantifier, computed once per enumerator, and the
+ * features of the individual terms, cached per variable and term.
+ */
 class AStarTupleEnumerator : public TermTupleEnumeratorBase
 {
  public:
@@ -157,7 +379,9 @@ class AStarTupleEnumerator : public TermTupleEnumeratorBase
                        const TermTupleEnumeratorEnv* env,
                        MLProducer* termProducer)
       : TermTupleEnumeratorBase(quantifier, global, env),
-        d_predictions(termProducer)
+        d_predictions(termProducer),
+        d_beamWidth(std::max(options::fullSaturateAStarBeam(), 0)),
+        d_tupleFeatures(&TermTupleFeatureProperties::s_features)
   {
     Assert(d_predictions == env->d_termProducer);
   }
@@ -166,11 +390,11 @@ class AStarTupleEnumerator : public TermTupleEnumeratorBase
   virtual void initializeAttempts() override;
   virtual bool nextCombinationAttempt() override;
 
-  typedef ImmutableVector<size_t> Tuple;
+  /** An element of the frontier, its tuple is stored in d_arena. */
   struct ScoredTuple
   {
-    Tuple d_tuple;
     float d_score;
+    uint32_t d_slot;
   };
   struct ScoredTupleCompare
   {
@@ -179,25 +403,56 @@ class AStarTupleEnumerator : public TermTupleEnumeratorBase
       return a.d_score < b.d_score;
     }
   };
+  /** Features of a term for a variable, except for the number of tries,
+   * which changes during the enumeration and is read from d_info. */
+  struct TermSegment
+  {
+    SparseFeatures d_entries;
+    const TermCandidateInfo* d_info;
+  };
 
  protected:
   static ScoredTupleCompare s_compare;
   typedef std::vector<ScoredTuple> Heap;
   MLProducer* d_predictions;
-  std::unordered_set<Tuple,
-                     ImmutableVector_hash<size_t>,
-                     ImmutableVector_equal<size_t>>
-      d_visited;
+  /** maximal size of the frontier after trimming, 0 for unbounded */
+  const size_t d_beamWidth;
+  /** tuples of the frontier, d_variableCount digits per slot */
+  std::vector<uint32_t> d_arena;
+  /** slots of the arena not used by any tuple */
+  std::vector<uint32_t> d_freeSlots;
   Heap d_open;
-  void push(const std::vector<size_t>& tuple);
-  float calculateScore(const Tuple& tuple);
+  /** slots of tuples waiting to be scored and pushed by pushStaged */
+  std::vector<uint32_t> d_staged;
+  /** scores of the staged tuples */
+  std::vector<double> d_scores;
+  /** features of the quantifier, the common prefix of all tuple features */
+  FeatureVector d_tupleFeatures;
+  const QuantifierFeatures* d_quantifierFeatures = nullptr;
+  /** number of features of a term segment without the number of tries */
+  size_t d_segmentSize = 0;
+  /** term segments per variable, indexed by the term index */
+  std::vector<std::unordered_map<size_t, TermSegment>> d_termSegments;
+  /** Copy a tuple into the arena, to be pushed by the next pushStaged. */
+  void stage(const std::vector<size_t>& tuple);
+  /** Score all staged tuples and push them to the frontier. */
+  void pushStaged();
+  /** Drop the worst tuples of the frontier so that d_beamWidth remain. */
+  void trim();
+  uint32_t allocateSlot();
+  const uint32_t* slotBegin(uint32_t slot) const
+  {
+    return d_arena.data() + slot * d_variableCount;
+  }
+  /** Fill d_scores with the scores of the staged tuples. */
+  void calculateScores();
+  const TermSegment& getTermSegment(size_t varIx, size_t termIx);
 };
-static Cvc5ostream& operator<<(Cvc5ostream& out,
-                               const AStarTupleEnumerator::ScoredTuple& t)
+void AStarTupleEnumerator::initializeAttempts()
 {
-  return out << "[" << t.d_tuple << ", " << t.d_score << "]";
+  stage(d_termIndex);
+  pushStaged();
 }
-void AStarTupleEnumerator::initializeAttempts() { push(d_termIndex); }
 bool AStarTupleEnumerator::nextCombinationAttempt()
 {
   if (d_open.empty())
@@ -206,14 +461,24 @@ bool AStarTupleEnumerator::nextCombinationAttempt()
   }
   // pop largest element from the heap (top)
   std::pop_heap(d_open.begin(), d_open.end(), s_compare);
-  ScoredTuple top = d_open.back();
+  const ScoredTuple top = d_open.back();
   d_open.pop_back();
-  Trace("inst-alg-rd") << "[A*] Pop " << top << std::endl;
-  // push top's neighbors
-  d_termIndex.clear();
-  d_termIndex.insert(d_termIndex.end(), top.d_tuple.begin(), top.d_tuple.end());
+  d_termIndex.assign(slotBegin(top.d_slot),
+                     slotBegin(top.d_slot) + d_variableCount);
+  d_freeSlots.push_back(top.d_slot);
+  Trace("inst-alg-rd") << "[A*] Pop [" << d_termIndex << ", " << top.d_score
+                       << "]" << std::endl;
+  // push top's successors, only digits from the last nonzero one on increase
+  size_t lastNonZero = 0;
+  for (size_t varIx = 0; varIx < d_variableCount; varIx++)
+  {
+    if (d_termIndex[varIx] > 0)
+    {
+      lastNonZero = varIx;
+    }
+  }
   std::vector<size_t> temporary;
-  for (size_t varIx = d_termIndex.size(); varIx--;)
+  for (size_t varIx = d_variableCount; varIx-- > lastNonZero;)
   {
     const auto newValue = d_termIndex[varIx] + 1;
     if (newValue >= d_termsSizes[varIx])
@@ -222,76 +487,188 @@ bool AStarTupleEnumerator::nextCombinationAttempt()
     }
     temporary = d_termIndex;
     temporary[varIx] = newValue;
-    push(temporary);
+    stage(temporary);
   }
+  pushStaged();
   Trace("inst-alg-rd") << "[A*] Heap size " << d_open.size() << std::endl;
   return true;
 }
-void AStarTupleEnumerator::push(const std::vector<size_t>& values)
+uint32_t AStarTupleEnumerator::allocateSlot()
 {
-  Assert(values.size() == d_variableCount);
-  Tuple tuple(values);
-  if (!d_visited.insert(tuple).second)
+  if (!d_freeSlots.empty())
   {
-    return;  // already seen
+    const uint32_t slot = d_freeSlots.back();
+    d_freeSlots.pop_back();
+    return slot;
   }
-  d_open.resize(d_open.size() + 1);
-  auto& newElement = d_open.back();
-  newElement.d_tuple = tuple;
-  newElement.d_score = calculateScore(tuple);
-
-  Trace("inst-alg-rd") << "[A*] Push " << newElement << std::endl;
-  std::push_heap(d_open.begin(), d_open.end(), s_compare);
+  const size_t slot = d_variableCount ? d_arena.size() / d_variableCount : 0;
+  AlwaysAssert(slot < std::numeric_limits<uint32_t>::max());
+  d_arena.resize(d_arena.size() + d_variableCount);
+  return slot;
 }
-float AStarTupleEnumerator::calculateScore(const Tuple& tuple)
+void AStarTupleEnumerator::stage(const std::vector<size_t>& values)
 {
-  float rv = 1;
-  if (d_global->d_tuplePredictor)
+  Assert(values.size() == d_variableCount);
+  const uint32_t slot = allocateSlot();
+  std::copy(
+      values.begin(), values.end(), d_arena.begin() + slot * d_variableCount);
+  d_staged.push_back(slot);
+}
+void AStarTupleEnumerator::pushStaged()
+{
+  if (d_staged.empty())
+  {
+    return;
+  }
+  calculateScores();
+  for (size_t i = 0; i < d_staged.size(); i++)
   {
-    TimerStat::CodeTimer codeTimer(d_global->d_learningTimer);
-    // set of features for quantifier
-    Featurize quantifierFeatures(true);
-    FeatureVector featureVector(&TermTupleFeatureProperties::s_features);
+    const ScoredTuple newElement{static_cast<float>(d_scores[i]), d_staged[i]};
+    d_open.push_back(newElement);
+    if (Trace.isOn("inst-alg-rd"))
     {
-      TimerStat::CodeTimer codeTimer1(d_global->d_featurizeTimer);
-      quantifierFeatures.count(d_quantifier);
+      const uint32_t* tuple = slotBegin(newElement.d_slot);
+      Trace("inst-alg-rd") << "[A*] Push ["
+                           << std::vector<size_t>(tuple,
+                                                  tuple + d_variableCount)
+                           << ", " << newElement.d_score << "]" << std::endl;
     }
-    Trace("inst-alg-rd") << "setting up quantifier features" << std::endl;
-    // featurize current quantifier
-    featurizeQuantifier(&featureVector, quantifierFeatures);
-    bool oversized = false;
+    std::push_heap(d_open.begin(), d_open.end(), s_compare);
+  }
+  d_staged.clear();
+  d_global->d_astarMaxFrontier.maxAssign(d_open.size());
+  if (d_beamWidth > 0 && d_open.size() >= 2 * d_beamWidth)
+  {
+    trim();
+  }
+}
+void AStarTupleEnumerator::trim()
+{
+  // move the best d_beamWidth tuples to the front
+  std::nth_element(d_open.begin(),
+                   d_open.begin() + d_beamWidth,
+                   d_open.end(),
+                   [](const ScoredTuple& a, const ScoredTuple& b) {
+                     return s_compare(b, a);
+                   });
+  for (size_t i = d_beamWidth; i < d_open.size(); i++)
+  {
+    d_freeSlots.push_back(d_open[i].d_slot);
+  }
+  d_global->d_astarEvictions += d_open.size() - d_beamWidth;
+  Trace("inst-alg-rd") << "[A*] Evicting " << d_open.size() - d_beamWidth
+                       << std::endl;
+  d_open.resize(d_beamWidth);
+  std::make_heap(d_open.begin(), d_open.end(), s_compare);
+}
+const AStarTupleEnumerator::TermSegment& AStarTupleEnumerator::getTermSegment(
+    size_t varIx, size_t termIx)
+{
+  auto [it, wasInserted] = d_termSegments[varIx].try_emplace(termIx);
+  auto& segment = it->second;
+  if (wasInserted)
+  {
+    const Node& term = d_predictions->getTerm(varIx, termIx);
     const auto& qinfo =
         QuantifierLogger::s_logger.getQuantifierInfo(d_quantifier);
-    for (size_t varIx = 0; varIx < tuple.size(); varIx++)
+    segment.d_info = &qinfo.d_infos[varIx].at(term);
+    FeatureVector features(&TermTupleFeatureProperties::s_features);
+    featurizeTermStable(&features,
+                        d_global->d_featureCache.getTermFeatures(term),
+                        varIx,
+                        *segment.d_info,
+                        *d_quantifierFeatures);
+    d_segmentSize = features.size();
+    for (size_t i = 0; i < features.indices().size(); i++)
+    {
+      segment.d_entries.push_back(
+          {features.indices()[i], features.values()[i]});
+    }
+  }
+  return segment;
+}
+void AStarTupleEnumerator::calculateScores()
+{
+  d_scores.assign(d_staged.size(), 1);
+  // tuples with a variable without terms are not scored by the tuple
+  // predictor
+  std::vector<bool> oversized(d_staged.size(), false);
+  for (size_t i = 0; i < d_staged.size(); i++)
+  {
+    const uint32_t* tuple = slotBegin(d_staged[i]);
+    for (size_t varIx = 0; varIx < d_variableCount; varIx++)
+    {
+      const bool oversizedDigit = tuple[varIx] >= d_termsSizes[varIx];
+      Assert(!oversizedDigit
+             || (tuple[varIx] == 0 && d_termsSizes[varIx] == 0));
+      oversized[i] = oversized[i] || oversizedDigit;
+    }
+  }
+  if (!d_global->d_tuplePredictor)
+  {
+    for (size_t i = 0; i < d_staged.size(); i++)
     {
-      const auto termIx = tuple[varIx];
-      oversized |= termIx >= d_termsSizes[varIx];
-      Assert(!oversized || (termIx == 0 && d_termsSizes[varIx] == 0));
-      if (oversized)  // TODO
+      const uint32_t* tuple = slotBegin(d_staged[i]);
+      for (size_t varIx = 0; varIx < d_variableCount; varIx++)
       {
-        break;
+        // a variable without terms does not affect the score
+        if (tuple[varIx] < d_termsSizes[varIx])
+        {
+          d_scores[i] *= d_predictions->predict(varIx, tuple[varIx]);
+        }
       }
-      const Node& term = d_predictions->getTerm(varIx, termIx);
-      const auto& candidateInfo = qinfo.d_infos[varIx].at(term);
-      featurizeTerm(
-          &featureVector, term, varIx, candidateInfo, quantifierFeatures);
     }
-    rv = oversized
-             ? 1
-             : d_global->d_tuplePredictor->predict(featureVector.rawValues());
+    return;
   }
-  else
+  TimerStat::CodeTimer codeTimer(d_global->d_learningTimer);
+  FeatureMatrix rows;
+  std::vector<size_t> rowTuples;
   {
-    for (size_t varIx = 0; varIx < tuple.size(); varIx++)
+    TimerStat::CodeTimer codeTimer1(d_global->d_featurizeTimer);
+    if (d_quantifierFeatures == nullptr)
     {
-      const auto termIx = tuple[varIx];
-      const bool oversized = termIx >= d_termsSizes[varIx];
-      Assert(!oversized || (termIx == 0 && d_termsSizes[varIx] == 0));
-      const auto score = oversized ? 1 : d_predictions->predict(varIx, termIx);
-      rv *= score;
+      Trace("inst-alg-rd") << "setting up quantifier features" << std::endl;
+      d_quantifierFeatures =
+          &d_global->d_featureCache.getQuantifierFeatures(d_quantifier);
+      featurizeQuantifier(&d_tupleFeatures, *d_quantifierFeatures);
+      d_termSegments.resize(d_variableCount);
     }
+    for (size_t i = 0; i < d_staged.size(); i++)
+    {
+      if (oversized[i])
+      {
+        continue;
+      }
+      const uint32_t* tuple = slotBegin(d_staged[i]);
+      d_tupleFeatures.push();
+      for (size_t varIx = 0; varIx < d_variableCount; varIx++)
+      {
+        const auto& segment = getTermSegment(varIx, tuple[varIx]);
+        d_tupleFeatures.addBlock(d_segmentSize, segment.d_entries);
+        d_tupleFeatures.addValue(segment.d_info->d_tried);
+      }
+      rows.addRow(d_tupleFeatures);
+      d_tupleFeatures.pop();
+      rowTuples.push_back(i);
+    }
+  }
+  if (rows.rowCount() == 0)
+  {
+    return;
+  }
+  std::vector<double> predictions(rows.rowCount());
+  {  // score all the tuples at once
+    TimerStat::CodeTimer predictTimer(d_global->d_mlTimer);
+    d_global->d_tuplePredictor->predictBatchCSR(rows.rowStarts(),
+                                                rows.indices(),
+                                                rows.values(),
+                                                rows.rowCount(),
+                                                predictions.data());
+  }
+  for (size_t row = 0; row < rowTuples.size(); row++)
+  {
+    d_scores[rowTuples[row]] = predictions[row];
   }
-  return rv;
 }
 TermTupleEnumeratorInterface* mkAStarTermTupleEnumerator(
     Node q,
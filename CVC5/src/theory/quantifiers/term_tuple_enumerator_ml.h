@@ -16,6 +16,11 @@ namespace quantifiers {
  * The ML predictor is assumed to give scores over the individual terms.
  * This score is then used to order the terms, i.e., the scores define the
  * permutation.
+ *
+ * The permutation is materialized lazily: all terms are scored at once, put
+ * into a heap, and popped from it only as far as the enumerator asks for
+ * terms. Ties are broken by the original position of the term, so the order
+ * is the same as that of a stable sort by decreasing score.
  * */
 class MLProducer : public ITermProducer
 {
@@ -33,14 +38,16 @@ class MLProducer : public ITermProducer
                        size_t term_index) override CVC5_WARN_UNUSED_RESULT
   {
     Assert(d_initialized);
-    return d_producer->getTerm(variableIx,
-                               d_permutations[variableIx][term_index]);
+    return d_producer->getTerm(variableIx, orderedTerm(variableIx, term_index));
   }
   /**  implementation of ITermProducer*/
   virtual void initialize() override
   {
-    runPrediction();
-    d_initialized = true;
+    if (!d_initialized)
+    {
+      runPrediction();
+      d_initialized = true;
+    }
   }
   /**  implementation of ITermProducer*/
   virtual Node getTermOriginal(size_t variableIx, size_t term_index) override
@@ -49,26 +56,81 @@ class MLProducer : public ITermProducer
   }
 
   /** Obtain a calculated prediction score for a given term. */
-  double predict(size_t variableIx, size_t termIx) const
+  double predict(size_t variableIx, size_t termIx)
   {
     Assert(d_initialized);
     Assert(variableIx < d_permutations.size());
-    Assert(d_permutations[variableIx].size() > termIx);
-    return d_predictions[variableIx][d_permutations[variableIx][termIx]];
+    return d_predictions[variableIx][orderedTerm(variableIx, termIx)];
   }
 
+  /** Calculate the predictions of the given producers, whose terms have been
+   * prepared, as if each was initialized. The features of all terms are
+   * calculated up front and the producers are scored concurrently, with up
+   * to threadCount threads if the predictor allows it. The predictions of
+   * each producer depend only on its own terms, so they do not depend on the
+   * number of threads. */
+  static void predictAll(const std::vector<MLProducer*>& producers,
+                         size_t threadCount);
+
+  /** time spent in featurizing and in scoring the terms, in milliseconds,
+   * measured only if TermTupleEnumeratorGlobal::d_profile is set */
+  double d_featurizeTime = 0;
+  double d_predictTime = 0;
+
  protected:
   TermTupleEnumeratorGlobal* const d_global;
   const TermTupleEnumeratorEnv* d_env;
   ITermProducer* const d_producer;
   const Node d_quantifier;
   bool d_initialized = false;
+  /** number of terms of each variable */
+  std::vector<size_t> d_termCounts;
+  /** for each variable, the prefix of the permutation materialized so far */
   std::vector<std::vector<size_t>> d_permutations;
+  /** for each variable, a heap of the terms not yet in the permutation */
+  std::vector<std::vector<size_t>> d_heaps;
   std::vector<std::vector<double>> d_predictions;
-  void runPrediction(const Featurize& quantifierFeatures,
-                     FeatureVector& features,
-                     size_t variableIx);
+  /** The original index of the term at the given position of the order. */
+  size_t orderedTerm(size_t variableIx, size_t position)
+  {
+    Assert(position < d_termCounts[variableIx]);
+    if (position >= d_permutations[variableIx].size())
+    {
+      extendOrder(variableIx, position + 1);
+    }
+    return d_permutations[variableIx][position];
+  }
+  /** Materialize the permutation of the variable up to the given length. */
+  void extendOrder(size_t variableIx, size_t length);
+  /** Add a row of features for each term of the given variable that needs to
+   * be scored, recording the variable and term of each row in rowTerms. The
+   * remaining terms take their score from the prediction cache. */
+  void featurizeTerms(const QuantifierFeatures& quantifierFeatures,
+                      FeatureVector& features,
+                      size_t variableIx,
+                      FeatureMatrix& rows,
+                      std::vector<std::pair<size_t, size_t>>& rowTerms);
+  /** Set up the lazy order of the terms of the variable by the predictions
+   * for them. */
+  void orderTerms(size_t variableIx);
   void runPrediction();
+  /** the rows of the terms to be scored and their variables and terms */
+  FeatureMatrix d_rows;
+  std::vector<std::pair<size_t, size_t>> d_rowTerms;
+  /** the scores of d_rows */
+  std::vector<double> d_rowScores;
+  /** whether the predictor provided d_rowScores, which are otherwise not
+   * cached */
+  bool d_rowScoresValid = false;
+  /** The first step of runPrediction, fill d_rows by the features of the
+   * terms that need to be scored. */
+  void featurizeCandidates();
+  /** The second step of runPrediction, score d_rows, the only step that may
+   * run concurrently for different producers. */
+  void scoreCandidates();
+  /** The last step of runPrediction, distribute the scores of d_rows to the
+   * terms and order them. */
+  void finishPrediction();
 };
 /**
  * Create a term producer based on ML prediction.
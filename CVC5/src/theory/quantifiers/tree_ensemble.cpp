@@ -0,0 +1,357 @@
+#include "theory/quantifiers/tree_ensemble.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "base/check.h"
+#include "base/output.h"
+
+namespace cvc5 {
+
+/** LightGBM treats values within this distance from zero as zero. */
+static const double s_zeroThreshold = 1e-35f;
+
+/** Masks of the decision type of a node, as used by LightGBM. */
+static const uint8_t s_categoricalMask = 1;
+static const uint8_t s_defaultLeftMask = 2;
+/** Missing value types of a node, as used by LightGBM. */
+static const uint8_t s_missingZero = 1;
+static const uint8_t s_missingNaN = 2;
+
+/** Parse a whitespace-separated list of values. */
+template <typename T>
+static std::vector<T> parseList(const std::map<std::string, std::string>& keys,
+                                const std::string& key,
+                                size_t expectedSize)
+{
+  const auto it = keys.find(key);
+  AlwaysAssert(it != keys.end())
+      << "tree ensemble: tree is missing " << key << std::endl;
+  std::vector<T> values;
+  values.reserve(expectedSize);
+  std::istringstream in(it->second);
+  // read through strtod, which unlike operator>> accepts "inf" and "nan" as
+  // written by LightGBM for unbounded thresholds
+  std::string token;
+  while (in >> token)
+  {
+    values.push_back(static_cast<T>(std::strtod(token.c_str(), nullptr)));
+  }
+  AlwaysAssert(values.size() == expectedSize)
+      << "tree ensemble: expected " << expectedSize << " values for " << key
+      << " but got " << values.size() << std::endl;
+  return values;
+}
+
+static size_t parseSize(const std::map<std::string, std::string>& keys,
+                        const std::string& key)
+{
+  const auto it = keys.find(key);
+  AlwaysAssert(it != keys.end())
+      << "tree ensemble: tree is missing " << key << std::endl;
+  return std::stoul(it->second);
+}
+
+TreeEnsemble::TreeEnsemble(const char* modelFile)
+{
+  std::ifstream in(modelFile);
+  AlwaysAssert(in.good()) << "tree ensemble: cannot open model file "
+                          << modelFile << std::endl;
+  load(in);
+  Trace("ml") << "Loaded tree ensemble " << modelFile << " with "
+              << numberOfTrees() << " trees." << std::endl;
+}
+
+TreeEnsemble::TreeEnsemble(std::istream& in) { load(in); }
+
+void TreeEnsemble::load(std::istream& in)
+{
+  std::string line;
+  bool inTree = false, seenMaxFeature = false;
+  std::map<std::string, std::string> treeKeys;
+  while (std::getline(in, line))
+  {
+    if (!line.empty() && line.back() == '\r')
+    {
+      line.pop_back();
+    }
+    const bool treeStart = line.compare(0, 5, "Tree=") == 0;
+    if (treeStart || line.empty() || line == "end of trees")
+    {
+      if (inTree)
+      {
+        addTree(treeKeys);
+        treeKeys.clear();
+      }
+      inTree = treeStart;
+      if (line == "end of trees")
+      {
+        break;
+      }
+      continue;
+    }
+    const auto eq = line.find('=');
+    const std::string key = line.substr(0, eq);
+    const std::string value =
+        eq == std::string::npos ? std::string() : line.substr(eq + 1);
+    if (inTree)
+    {
+      treeKeys[key] = value;
+    }
+    else if (key == "max_feature_idx")
+    {
+      d_numFeatures = std::stoul(value) + 1;
+      seenMaxFeature = true;
+    }
+    else if (key == "num_class" || key == "num_tree_per_iteration")
+    {
+      AlwaysAssert(std::stoul(value) == 1)
+          << "tree ensemble: only single-class models are supported"
+          << std::endl;
+    }
+    else if (key == "objective")
+    {
+      setObjective(value);
+    }
+    else if (key == "average_output")
+    {
+      d_averageOutput = true;
+    }
+  }
+  if (inTree)
+  {
+    addTree(treeKeys);
+  }
+  d_catBoundaries.push_back(d_catThreshold.size());
+  AlwaysAssert(seenMaxFeature)
+      << "tree ensemble: model is missing max_feature_idx" << std::endl;
+  AlwaysAssert(!d_roots.empty())
+      << "tree ensemble: model contains no trees" << std::endl;
+}
+
+void TreeEnsemble::setObjective(const std::string& objective)
+{
+  std::istringstream in(objective);
+  std::string name, parameter;
+  in >> name;
+  if (name == "binary" || name == "cross_entropy" || name == "xentropy")
+  {
+    d_output = Output::SIGMOID;
+    d_sigmoid = 1;
+    while (in >> parameter)
+    {
+      if (parameter.compare(0, 8, "sigmoid:") == 0)
+      {
+        d_sigmoid = std::stod(parameter.substr(8));
+      }
+    }
+  }
+  else if (name == "poisson" || name == "gamma" || name == "tweedie")
+  {
+    d_output = Output::EXP;
+  }
+  else
+  {
+    AlwaysAssert(name.compare(0, 10, "multiclass") != 0
+                 && name != "cross_entropy_lambda" && name != "xentlambda"
+                 && objective.find("sqrt") == std::string::npos)
+        << "tree ensemble: unsupported objective " << objective << std::endl;
+    d_output = Output::RAW;
+  }
+}
+
+void TreeEnsemble::addTree(const std::map<std::string, std::string>& keys)
+{
+  const auto isLinear = keys.find("is_linear");
+  AlwaysAssert(isLinear == keys.end() || isLinear->second == "0")
+      << "tree ensemble: linear trees are not supported" << std::endl;
+  const size_t leafCount = parseSize(keys, "num_leaves");
+  const int32_t leafBase = d_leafValue.size();
+  const auto leafValues = parseList<double>(keys, "leaf_value", leafCount);
+  d_leafValue.insert(d_leafValue.end(), leafValues.begin(), leafValues.end());
+  if (leafCount <= 1)
+  {
+    d_roots.push_back(~leafBase);
+    return;
+  }
+
+  const size_t nodeCount = leafCount - 1;
+  const int32_t nodeBase = d_splitFeature.size();
+  const int32_t catSetBase = d_catBoundaries.size();
+  const size_t catCount =
+      keys.count("num_cat") ? parseSize(keys, "num_cat") : 0;
+  if (catCount > 0)
+  {
+    const auto boundaries =
+        parseList<int32_t>(keys, "cat_boundaries", catCount + 1);
+    const int32_t thresholdBase = d_catThreshold.size();
+    for (size_t i = 0; i < catCount; i++)
+    {
+      d_catBoundaries.push_back(thresholdBase + boundaries[i]);
+    }
+    const auto bits =
+        parseList<uint32_t>(keys, "cat_threshold", boundaries[catCount]);
+    d_catThreshold.insert(d_catThreshold.end(), bits.begin(), bits.end());
+  }
+
+  const auto features = parseList<int32_t>(keys, "split_feature", nodeCount);
+  const auto thresholds = parseList<double>(keys, "threshold", nodeCount);
+  const auto decisionTypes =
+      parseList<int32_t>(keys, "decision_type", nodeCount);
+  const auto lefts = parseList<int32_t>(keys, "left_child", nodeCount);
+  const auto rights = parseList<int32_t>(keys, "right_child", nodeCount);
+  // renumber nodes and leaves of the tree into the global arrays
+  const auto relocate = [nodeBase, leafBase](int32_t child) {
+    return child >= 0 ? nodeBase + child : ~(leafBase + ~child);
+  };
+  for (size_t i = 0; i < nodeCount; i++)
+  {
+    AlwaysAssert(features[i] >= 0
+                 && static_cast<size_t>(features[i]) < d_numFeatures)
+        << "tree ensemble: split on unknown feature " << features[i]
+        << std::endl;
+    const uint8_t decisionType = decisionTypes[i];
+    d_splitFeature.push_back(features[i]);
+    d_threshold.push_back((decisionType & s_categoricalMask)
+                              ? catSetBase + thresholds[i]
+                              : thresholds[i]);
+    d_decisionType.push_back(decisionType);
+    d_leftChild.push_back(relocate(lefts[i]));
+    d_rightChild.push_back(relocate(rights[i]));
+  }
+  d_roots.push_back(nodeBase);
+}
+
+int32_t TreeEnsemble::decide(int32_t node, double value) const
+{
+  const uint8_t decisionType = d_decisionType[node];
+  // LightGBM drops near-zero values when reading a dense row
+  if (std::fabs(value) <= s_zeroThreshold)
+  {
+    value = 0;
+  }
+  if (decisionType & s_categoricalMask)
+  {
+    const int intValue = std::isnan(value) ? -1 : static_cast<int>(value);
+    if (intValue < 0)
+    {
+      return d_rightChild[node];
+    }
+    const size_t category = intValue;
+    const size_t set = static_cast<size_t>(d_threshold[node]);
+    const size_t begin = d_catBoundaries[set];
+    const size_t wordCount = d_catBoundaries[set + 1] - begin;
+    const size_t word = category / 32;
+    const bool member =
+        word < wordCount
+        && ((d_catThreshold[begin + word] >> (category % 32)) & 1);
+    return member ? d_leftChild[node] : d_rightChild[node];
+  }
+  const uint8_t missingType = (decisionType >> 2) & 3;
+  if (std::isnan(value) && missingType != s_missingNaN)
+  {
+    value = 0;
+  }
+  if ((missingType == s_missingZero && value == 0)
+      || (missingType == s_missingNaN && std::isnan(value)))
+  {
+    return (decisionType & s_defaultLeftMask) ? d_leftChild[node]
+                                              : d_rightChild[node];
+  }
+  return value <= d_threshold[node] ? d_leftChild[node] : d_rightChild[node];
+}
+
+double TreeEnsemble::transform(double raw) const
+{
+  if (d_averageOutput)
+  {
+    raw /= d_roots.size();
+  }
+  switch (d_output)
+  {
+    case Output::SIGMOID: return 1.0 / (1.0 + std::exp(-d_sigmoid * raw));
+    case Output::EXP: return std::exp(raw);
+    default: return raw;
+  }
+}
+
+double TreeEnsemble::predict(const float* features)
+{
+  double raw = 0;
+  for (const int32_t root : d_roots)
+  {
+    raw += d_leafValue[findLeaf(root, features)];
+  }
+  const double prediction = transform(raw);
+  Trace("ml") << "prediction :" << prediction << std::endl;
+  return prediction;
+}
+
+void TreeEnsemble::predictBatch(const float* rows,
+                                size_t rowCount,
+                                double* out)
+{
+  // Evaluate the rows in blocks, tree by tree, so that each tree stays in
+  // cache while the whole block passes through it. Trees are summed in the
+  // same order as in predict, so the results are identical.
+  double raw[s_blockSize];
+  for (size_t blockStart = 0; blockStart < rowCount; blockStart += s_blockSize)
+  {
+    const size_t blockRows = std::min(s_blockSize, rowCount - blockStart);
+    const float* block = rows + blockStart * d_numFeatures;
+    std::fill(raw, raw + blockRows, 0.0);
+    for (const int32_t root : d_roots)
+    {
+      if (root < 0)
+      {
+        const double value = d_leafValue[~root];
+        for (size_t i = 0; i < blockRows; i++)
+        {
+          raw[i] += value;
+        }
+        continue;
+      }
+      for (size_t i = 0; i < blockRows; i++)
+      {
+        raw[i] += d_leafValue[findLeaf(root, block + i * d_numFeatures)];
+      }
+    }
+    for (size_t i = 0; i < blockRows; i++)
+    {
+      out[blockStart + i] = transform(raw[i]);
+    }
+  }
+}
+
+bool TreeEnsemble::predictBatchCSR(const int32_t* rowStarts,
+                                   const int32_t* indices,
+                                   const float* values,
+                                   size_t rowCount,
+                                   double* out)
+{
+  // expand the rows block by block and evaluate them densely
+  std::vector<float> block(s_blockSize * d_numFeatures);
+  for (size_t blockStart = 0; blockStart < rowCount; blockStart += s_blockSize)
+  {
+    const size_t blockRows = std::min(s_blockSize, rowCount - blockStart);
+    std::fill(block.begin(), block.end(), 0.0f);
+    for (size_t i = 0; i < blockRows; i++)
+    {
+      const size_t row = blockStart + i;
+      for (int32_t j = rowStarts[row]; j < rowStarts[row + 1]; j++)
+      {
+        if (static_cast<size_t>(indices[j]) < d_numFeatures)
+        {
+          block[i * d_numFeatures + indices[j]] = values[j];
+        }
+      }
+    }
+    predictBatch(block.data(), blockRows, out + blockStart);
+  }
+  return true;
+}
+
+}  // namespace cvc5
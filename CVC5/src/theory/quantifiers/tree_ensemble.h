@@ -0,0 +1,112 @@
+#ifndef CVC5__THEORY__QUANTIFIERS__TREE_ENSEMBLE_H
+#define CVC5__THEORY__QUANTIFIERS__TREE_ENSEMBLE_H
+
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "theory/quantifiers/ml.h"
+
+namespace cvc5 {
+
+/**\brief Built-in evaluator of LightGBM tree ensembles.
+ *
+ * The evaluator reads a LightGBM model in the text format (as written by
+ * `lightgbm task=train` or `Booster::save_model`) and evaluates it without
+ * going through the LightGBM runtime.
+ *
+ * All trees are flattened into a single struct-of-arrays layout. Internal
+ * nodes of all trees are numbered consecutively and described by the arrays
+ * d_splitFeature, d_threshold, d_decisionType, d_leftChild and d_rightChild.
+ * A child is either a non-negative index of an internal node, or a negative
+ * number c, in which case ~c is an index into d_leafValue.  A tree consisting
+ * of a single leaf has a negative root.
+ *
+ * Only single-class models with numerical and categorical splits are
+ * supported, which covers the models trained by loop/scripts/train.conf.
+ * The output transformation (sigmoid for binary objectives, average for
+ * random forests) matches LightGBM's C_API_PREDICT_NORMAL.
+ */
+class TreeEnsemble : public PredictorInterface
+{
+ public:
+  /** Load a model from a LightGBM text model file. */
+  TreeEnsemble(const char* modelFile);
+  /** Load a model from a stream with the contents of a LightGBM model file. */
+  TreeEnsemble(std::istream& in);
+  virtual ~TreeEnsemble() {}
+
+  virtual double predict(const float* features) override;
+  virtual void predictBatch(const float* rows,
+                            size_t rowCount,
+                            double* out) override;
+  virtual bool predictBatchCSR(const int32_t* rowStarts,
+                               const int32_t* indices,
+                               const float* values,
+                               size_t rowCount,
+                               double* out) override;
+  virtual size_t numberOfFeatures() const override { return d_numFeatures; }
+  virtual bool isThreadSafe() const override { return true; }
+  /** Number of trees in the ensemble. */
+  size_t numberOfTrees() const { return d_roots.size(); }
+
+ protected:
+  /** Number of rows evaluated together, tree by tree, in predictBatch. */
+  static constexpr size_t s_blockSize = 64;
+
+  size_t d_numFeatures = 0;
+  /** The root of each tree, negative for single-leaf trees. */
+  std::vector<int32_t> d_roots;
+  /** Per internal node: the index of the tested feature. */
+  std::vector<int32_t> d_splitFeature;
+  /** Per internal node: the threshold, or the index of the category set. */
+  std::vector<double> d_threshold;
+  /** Per internal node: LightGBM decision type (categorical / default left /
+   * missing type bits). */
+  std::vector<uint8_t> d_decisionType;
+  /** Per internal node: left and right successors. */
+  std::vector<int32_t> d_leftChild, d_rightChild;
+  /** Values of all leaves of all trees. */
+  std::vector<double> d_leafValue;
+  /** Bitsets of categorical splits, delimited by d_catBoundaries. */
+  std::vector<uint32_t> d_catThreshold;
+  std::vector<int32_t> d_catBoundaries;
+  /** Transformation applied to the raw score, determined by the objective. */
+  enum class Output
+  {
+    RAW,
+    SIGMOID,
+    EXP
+  };
+  Output d_output = Output::RAW;
+  /** Scaling of the raw score inside the sigmoid. */
+  double d_sigmoid = 1;
+  /** Average the raw score over trees (random forest mode). */
+  bool d_averageOutput = false;
+
+  void load(std::istream& in);
+  /** Add a single tree given by the key-value pairs of its "Tree=" block. */
+  void addTree(const std::map<std::string, std::string>& keys);
+  /** Parse the objective line of the model file. */
+  void setObjective(const std::string& objective);
+
+  /** Index of the leaf reached by the given row in the tree with the given
+   * root. */
+  int32_t findLeaf(int32_t node, const float* features) const
+  {
+    while (node >= 0)
+    {
+      node = decide(node, features[d_splitFeature[node]]);
+    }
+    return ~node;
+  }
+  int32_t decide(int32_t node, double value) const;
+  /** Convert the raw score into the final prediction. */
+  double transform(double raw) const;
+};
+
+}  // namespace cvc5
+
+#endif /* CVC5__THEORY__QUANTIFIERS__TREE_ENSEMBLE_H */
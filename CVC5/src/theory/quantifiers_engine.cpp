@@ -26,6 +26,7 @@
 #include "theory/quantifiers/fmf/full_model_check.h"
 #include "theory/quantifiers/fmf/model_builder.h"
 #include "theory/quantifiers/quant_module.h"
+#include "theory/quantifiers/quantifier_logger.h"
 #include "theory/quantifiers/quantifiers_inference_manager.h"
 #include "theory/quantifiers/quantifiers_modules.h"
 #include "theory/quantifiers/quantifiers_registry.h"
@@ -34,6 +35,7 @@
 #include "theory/quantifiers/quantifiers_statistics.h"
 #include "theory/quantifiers/relevant_domain.h"
 #include "theory/quantifiers/skolemize.h"
+#include "theory/quantifiers/term_database.h"
 #include "theory/quantifiers/term_registry.h"
 #include "theory/theory_engine.h"
 
@@ -68,7 +70,14 @@ QuantifiersEngine::QuantifiersEngine(
   d_util.push_back(tr.getTermPools());
 }
 
-QuantifiersEngine::~QuantifiersEngine() {}
+QuantifiersEngine::~QuantifiersEngine()
+{
+  // destroy the modules first, so that the profile of --fs-profile is written
+  // while the logger still knows the useful instantiations
+  d_qmodules.reset();
+  // the logged nodes do not outlive their node manager
+  quantifiers::QuantifierLogger::s_logger.reset();
+}
 
 void QuantifiersEngine::finishInit(TheoryEngine* te)
 {
@@ -677,7 +686,16 @@ void QuantifiersEngine::assertQuantifier(Node f, bool pol)
   d_treg.addTerm(d_qreg.getInstConstantBody(f), true);
 }
 
-void QuantifiersEngine::eqNotifyNewClass(TNode t) { d_treg.addTerm(t); }
+void QuantifiersEngine::eqNotifyNewClass(TNode t)
+{
+  d_treg.addTerm(t);
+  d_treg.getTermDatabase()->eqNotifyNewClass(t);
+}
+
+void QuantifiersEngine::eqNotifyMerge(TNode t1, TNode t2)
+{
+  d_treg.getTermDatabase()->eqNotifyMerge(t1, t2);
+}
 
 void QuantifiersEngine::markRelevant(Node q) { d_model->markRelevant(q); }
 
@@ -934,11 +934,11 @@ void TheorySetsPrivate::addCarePairs(TNodeTrie* t1,
         }
       }
       // add care pairs based on each pair of non-disequal arguments
-      for (std::map<TNode, TNodeTrie>::iterator it = t1->d_data.begin();
+      for (TNodeTrie::ChildMap::iterator it = t1->d_data.begin();
            it != t1->d_data.end();
            ++it)
       {
-        std::map<TNode, TNodeTrie>::iterator it2 = it;
+        TNodeTrie::ChildMap::iterator it2 = it;
         ++it2;
         for (; it2 != t1->d_data.end(); ++it2)
         {
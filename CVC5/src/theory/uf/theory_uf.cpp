@@ -553,11 +553,11 @@ void TheoryUF::addCarePairs(const TNodeTrie* t1,
         }
       }
       //add care pairs based on each pair of non-disequal arguments
-      for (std::map<TNode, TNodeTrie>::const_iterator it = t1->d_data.begin();
+      for (TNodeTrie::ChildMap::const_iterator it = t1->d_data.begin();
            it != t1->d_data.end();
            ++it)
       {
-        std::map<TNode, TNodeTrie>::const_iterator it2 = it;
+        TNodeTrie::ChildMap::const_iterator it2 = it;
         ++it2;
         for( ; it2 != t1->d_data.end(); ++it2 ){
           if (!d_equalityEngine->areDisequal(it->first, it2->first, false))
@@ -0,0 +1,18 @@
+; COMMAND-LINE: --full-saturate-quant --no-e-matching
+; COMMAND-LINE: --full-saturate-quant --no-e-matching --fs-batch
+; COMMAND-LINE: --full-saturate-quant --fs-batch
+; EXPECT: unsat
+(set-logic UF)
+(set-info :status unsat)
+(declare-sort U 0)
+(declare-fun f (U) U)
+(declare-fun P (U) Bool)
+(declare-fun Q (U) Bool)
+(declare-fun a () U)
+(declare-fun b () U)
+(assert (forall ((x U)) (=> (P x) (Q (f x)))))
+(assert (forall ((x U)) (=> (Q x) (P (f x)))))
+(assert (P a))
+(assert (= b (f (f a))))
+(assert (not (P b)))
+(check-sat)
@@ -0,0 +1,17 @@
+; COMMAND-LINE: --inst-subst-cache
+; COMMAND-LINE: --inst-subst-cache --full-saturate-quant --no-e-matching
+; EXPECT: unsat
+(set-logic UF)
+(set-info :status unsat)
+(declare-sort U 0)
+(declare-fun f (U U) U)
+(declare-fun P (U) Bool)
+(declare-fun a () U)
+(declare-fun b () U)
+(declare-fun c () U)
+(assert (forall ((x U) (y U) (z U)) (=> (and (P x) (P y) (P z)) (P (f x (f y z))))))
+(assert (P a))
+(assert (P b))
+(assert (P c))
+(assert (not (P (f c (f b a)))))
+(check-sat)
@@ -0,0 +1,15 @@
+; COMMAND-LINE: --full-saturate-quant --no-e-matching
+; COMMAND-LINE: --full-saturate-quant --no-e-matching --rd-incremental
+; EXPECT: unsat
+(set-logic UF)
+(set-info :status unsat)
+(declare-sort U 0)
+(declare-fun f (U) U)
+(declare-fun P (U) Bool)
+(declare-fun Q (U) Bool)
+(declare-fun a () U)
+(assert (forall ((x U)) (=> (P x) (P (f x)))))
+(assert (forall ((x U)) (=> (P (f (f x))) (Q x))))
+(assert (P a))
+(assert (not (Q a)))
+(check-sat)
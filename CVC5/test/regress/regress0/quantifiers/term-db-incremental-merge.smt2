@@ -0,0 +1,18 @@
+; COMMAND-LINE: --inst-when=last-call
+; COMMAND-LINE: --inst-when=last-call --term-db-incremental
+; EXPECT: unsat
+(set-logic UF)
+(set-info :status unsat)
+(declare-sort U 0)
+(declare-fun f (U) U)
+(declare-fun g (U) U)
+(declare-fun R (U U) Bool)
+(declare-fun a () U)
+(declare-fun b () U)
+(declare-fun c () U)
+(assert (forall ((x U)) (! (= (g (f x)) x) :pattern ((f x)))))
+(assert (forall ((x U) (y U)) (! (=> (R x y) (= (f x) (f y))) :pattern ((R x y)))))
+(assert (R a b))
+(assert (R b c))
+(assert (not (= a c)))
+(check-sat)
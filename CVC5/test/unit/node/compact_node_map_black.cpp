@@ -0,0 +1,298 @@
+/******************************************************************************
+ * This file is part of the cvc5 project.
+ *
+ * Copyright (c) 2009-2021 by the authors listed in the file AUTHORS
+ * in the top-level source directory and their institutional affiliations.
+ * All rights reserved.  See the file COPYING in the top-level source
+ * directory for licensing information.
+ * ****************************************************************************
+ *
+ * Black box testing of cvc5::CompactNodeMap, and a micro-benchmark of tries
+ * of instantiations with std::map and CompactNodeMap children.
+ *
+ * The disabled benchmark (run with --gtest_also_run_disabled_tests) replays a
+ * sequence of instantiations, either synthetic or recorded by `-t inst` (the
+ * "*** Instantiate q with" lines followed by one indented line per term) in
+ * the file given by the environment variable CVC5_NODE_TRIE_TRACE. Recorded
+ * terms are replaced by fresh skolems, one per distinct string.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "expr/compact_node_map.h"
+#include "expr/node_trie.h"
+#include "test_node.h"
+
+namespace cvc5 {
+
+using namespace theory;
+
+namespace test {
+
+template <class K, class V>
+using StdNodeMap = std::map<K, V>;
+
+/** A trie of instantiations as InstMatchTrie, with the given children map. */
+template <template <class, class> class Map>
+class InstantiationTrie
+{
+ public:
+  /** Add terms, returns false if they were already in the trie. */
+  bool add(const std::vector<Node>& terms)
+  {
+    InstantiationTrie* t = this;
+    bool added = false;
+    for (const Node& n : terms)
+    {
+      auto it = t->d_data.find(n);
+      if (it == t->d_data.end())
+      {
+        added = true;
+        t = &t->d_data[n];
+      }
+      else
+      {
+        t = &it->second;
+      }
+    }
+    return added;
+  }
+
+ private:
+  Map<Node, InstantiationTrie> d_data;
+};
+
+/** A sequence of instantiations, as quantifier indices and terms. */
+struct InstantiationTrace
+{
+  std::vector<size_t> d_quantifiers;
+  std::vector<std::vector<Node>> d_terms;
+};
+
+class TestNodeBlackCompactNodeMap : public TestNode
+{
+ protected:
+  /** Fresh skolems of type integer. */
+  std::vector<Node> mkVars(size_t count)
+  {
+    std::vector<Node> vars;
+    for (size_t i = 0; i < count; i++)
+    {
+      vars.push_back(d_skolemManager->mkDummySkolem("x", *d_intTypeNode));
+    }
+    return vars;
+  }
+
+  /** A synthetic trace, the terms are drawn with a bias to the small indices
+   * of the pool, like the representatives of large equivalence classes, so
+   * that some instantiations repeat. */
+  InstantiationTrace syntheticTrace(size_t quantifierCount,
+                                    size_t termCount,
+                                    size_t instantiationCount,
+                                    unsigned seed)
+  {
+    std::mt19937 rng(seed);
+    std::geometric_distribution<size_t> term(4.0 / termCount);
+    const std::vector<Node> pool = mkVars(termCount);
+    InstantiationTrace trace;
+    for (size_t i = 0; i < instantiationCount; i++)
+    {
+      const size_t q = rng() % quantifierCount;
+      std::vector<Node> terms;
+      for (size_t j = 0, arity = 1 + q % 4; j < arity; j++)
+      {
+        terms.push_back(pool[std::min(term(rng), termCount - 1)]);
+      }
+      trace.d_quantifiers.push_back(q);
+      trace.d_terms.push_back(terms);
+    }
+    return trace;
+  }
+
+  /** A trace recorded by -t inst. */
+  InstantiationTrace recordedTrace(const std::string& fileName)
+  {
+    std::ifstream in(fileName);
+    std::map<std::string, size_t> quantifiers;
+    std::map<std::string, Node> terms;
+    InstantiationTrace trace;
+    std::string line;
+    bool inTerms = false;
+    while (std::getline(in, line))
+    {
+      const size_t start = line.find("*** Instantiate ");
+      if (start != std::string::npos && line.find(" with") != std::string::npos)
+      {
+        const std::string q =
+            line.substr(start + 16, line.rfind(" with") - start - 16);
+        const size_t index = quantifiers.size();
+        trace.d_quantifiers.push_back(
+            quantifiers.emplace(q, index).first->second);
+        trace.d_terms.emplace_back();
+        inTerms = true;
+      }
+      else if (inTerms && line.compare(0, 3, "   ") == 0)
+      {
+        Node& n = terms[line.substr(3)];
+        if (n.isNull())
+        {
+          n = d_skolemManager->mkDummySkolem("x", *d_intTypeNode);
+        }
+        trace.d_terms.back().push_back(n);
+      }
+      else
+      {
+        inTerms = false;
+      }
+    }
+    return trace;
+  }
+
+  /** Replay the trace twice, the second time every instantiation is a
+   * duplicate, returns whether each one was added. */
+  template <template <class, class> class Map>
+  static std::vector<bool> replay(const InstantiationTrace& trace)
+  {
+    std::map<size_t, InstantiationTrie<Map>> tries;
+    std::vector<bool> added;
+    for (size_t pass = 0; pass < 2; pass++)
+    {
+      for (size_t i = 0, size = trace.d_terms.size(); i < size; i++)
+      {
+        added.push_back(tries[trace.d_quantifiers[i]].add(trace.d_terms[i]));
+      }
+    }
+    return added;
+  }
+
+  template <template <class, class> class Map>
+  static double timeReplay(const InstantiationTrace& trace,
+                           size_t repetitions,
+                           std::vector<bool>& results)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < repetitions; i++)
+    {
+      results = replay<Map>(trace);
+    }
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() / repetitions;
+  }
+};
+
+TEST_F(TestNodeBlackCompactNodeMap, find_insert_erase)
+{
+  // past the size where lookups switch from scanning to hashing
+  const std::vector<Node> vars = mkVars(100);
+  CompactNodeMap<TNode, size_t> map;
+  ASSERT_TRUE(map.empty());
+  std::vector<size_t*> values;
+  for (size_t i = 0; i < vars.size(); i++)
+  {
+    ASSERT_EQ(map.find(vars[i]), map.end());
+    map[vars[i]] = i;
+    values.push_back(&map[vars[i]]);
+    ASSERT_EQ(map.size(), i + 1);
+    for (size_t j = 0; j <= i; j++)
+    {
+      ASSERT_EQ(map.count(vars[j]), 1u);
+      ASSERT_EQ(map.find(vars[j])->second, j);
+      // entries do not move when the map grows
+      ASSERT_EQ(&map.find(vars[j])->second, values[j]);
+    }
+  }
+  // iteration is in insertion order
+  size_t i = 0;
+  for (const std::pair<const TNode, size_t>& p : map)
+  {
+    ASSERT_EQ(p.first, vars[i]);
+    ASSERT_EQ(p.second, i);
+    i++;
+  }
+  ASSERT_EQ(i, vars.size());
+  for (i = 0; i < vars.size(); i += 2)
+  {
+    ASSERT_EQ(map.erase(vars[i]), 1u);
+    ASSERT_EQ(map.erase(vars[i]), 0u);
+  }
+  ASSERT_EQ(map.size(), vars.size() / 2);
+  for (i = 0; i < vars.size(); i++)
+  {
+    ASSERT_EQ(map.count(vars[i]), i % 2);
+    if (i % 2 == 1)
+    {
+      ASSERT_EQ(&map.find(vars[i])->second, values[i]);
+    }
+  }
+  CompactNodeMap<TNode, size_t> copy(map);
+  ASSERT_EQ(copy.size(), map.size());
+  ASSERT_EQ(copy.find(vars[1])->second, 1u);
+  map.clear();
+  ASSERT_TRUE(map.empty());
+  ASSERT_EQ(map.find(vars[1]), map.end());
+  ASSERT_EQ(copy.find(vars[99])->second, 99u);
+}
+
+TEST_F(TestNodeBlackCompactNodeMap, node_trie)
+{
+  const std::vector<Node> vars = mkVars(20);
+  NodeTrie trie;
+  ASSERT_TRUE(trie.addTerm(vars[0], {vars[1], vars[2]}));
+  ASSERT_FALSE(trie.addTerm(vars[3], {vars[1], vars[2]}));
+  ASSERT_EQ(trie.existsTerm({vars[1], vars[2]}), vars[0]);
+  ASSERT_TRUE(trie.existsTerm({vars[2], vars[1]}).isNull());
+  for (size_t i = 0; i < vars.size(); i++)
+  {
+    ASSERT_EQ(trie.addOrGetTerm(vars[i], {vars[4], vars[i]}), vars[i]);
+  }
+  for (size_t i = 0; i < vars.size(); i++)
+  {
+    ASSERT_EQ(trie.existsTerm({vars[4], vars[i]}), vars[i]);
+  }
+  ASSERT_EQ(trie.d_data.size(), 2u);
+  trie.clear();
+  ASSERT_TRUE(trie.empty());
+
+  // a trie with CompactNodeMap children, whatever the children of NodeTrie
+  // are, detects the same repeated instantiations as one with std::map
+  // children, with fan-outs on both sides of the switch to hashing
+  std::mt19937 rng(42);
+  InstantiationTrie<CompactNodeMap> compact;
+  InstantiationTrie<StdNodeMap> reference;
+  for (size_t i = 0; i < 2000; i++)
+  {
+    std::vector<Node> terms;
+    for (size_t j = 0, arity = 1 + i % 3; j < arity; j++)
+    {
+      terms.push_back(vars[rng() % vars.size()]);
+    }
+    ASSERT_EQ(compact.add(terms), reference.add(terms));
+  }
+}
+
+TEST_F(TestNodeBlackCompactNodeMap, DISABLED_benchmark)
+{
+  const char* recorded = std::getenv("CVC5_NODE_TRIE_TRACE");
+  const InstantiationTrace trace = recorded
+                                       ? recordedTrace(recorded)
+                                       : syntheticTrace(20, 500, 50000, 42);
+  std::vector<bool> stdResults, compactResults;
+  const double stdTime = timeReplay<StdNodeMap>(trace, 5, stdResults);
+  const double compactTime =
+      timeReplay<CompactNodeMap>(trace, 5, compactResults);
+  ASSERT_EQ(stdResults, compactResults);
+  std::cout << "node trie: " << trace.d_terms.size() << " instantiations, "
+            << "std::map " << stdTime << " ms, compact " << compactTime
+            << " ms" << std::endl;
+}
+
+}  // namespace test
+}  // namespace cvc5
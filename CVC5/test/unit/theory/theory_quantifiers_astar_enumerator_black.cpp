@@ -0,0 +1,132 @@
+/******************************************************************************
+ * This file is part of the cvc5 project.
+ *
+ * Copyright (c) 2009-2021 by the authors listed in the file AUTHORS
+ * in the top-level source directory and their institutional affiliations.
+ * All rights reserved.  See the file COPYING in the top-level source
+ * directory for licensing information.
+ * ****************************************************************************
+ *
+ * Black box testing of the order of tuples of the A* tuple enumerator.
+ */
+
+#include <memory>
+#include <vector>
+
+#include "smt/smt_engine_scope.h"
+#include "test_smt.h"
+#include "theory/quantifiers/term_tuple_enumerator.h"
+#include "theory/quantifiers/term_tuple_enumerator_ml.h"
+
+namespace cvc5 {
+
+using namespace kind;
+using namespace theory::quantifiers;
+
+namespace test {
+
+/** A term producer with fixed terms for each variable. */
+class FixedTermProducer : public ITermProducer
+{
+ public:
+  FixedTermProducer(const std::vector<std::vector<Node>>& terms)
+      : d_terms(terms)
+  {
+  }
+  size_t prepareTerms(size_t variableIx) override
+  {
+    return d_terms[variableIx].size();
+  }
+  Node getTerm(size_t variableIx, size_t termIx) override
+  {
+    return d_terms[variableIx][termIx];
+  }
+  void initialize() override {}
+
+ private:
+  std::vector<std::vector<Node>> d_terms;
+};
+
+/** An ML term producer whose scores are given rather than predicted. */
+class FixedScoreProducer : public MLProducer
+{
+ public:
+  FixedScoreProducer(TermTupleEnumeratorGlobal* global,
+                     const TermTupleEnumeratorEnv* env,
+                     ITermProducer* producer,
+                     Node quantifier,
+                     const std::vector<std::vector<double>>& scores)
+      : MLProducer(global, env, producer, quantifier), d_scores(scores)
+  {
+  }
+  void initialize() override
+  {
+    for (size_t variableIx = 0; variableIx < d_scores.size(); variableIx++)
+    {
+      d_predictions[variableIx] = d_scores[variableIx];
+      orderTerms(variableIx);
+    }
+    d_initialized = true;
+  }
+
+ private:
+  std::vector<std::vector<double>> d_scores;
+};
+
+class TestTheoryBlackQuantifiersAStarEnumerator : public TestSmt
+{
+};
+
+TEST_F(TestTheoryBlackQuantifiersAStarEnumerator, empty_variable)
+{
+  smt::SmtScope scope(d_smtEngine.get());
+  const TypeNode intType = d_nodeManager->integerType();
+  const Node x = d_nodeManager->mkBoundVar("x", intType);
+  const Node z = d_nodeManager->mkBoundVar("z", intType);
+  const Node y = d_nodeManager->mkBoundVar("y", intType);
+  const Node q =
+      d_nodeManager->mkNode(FORALL,
+                            d_nodeManager->mkNode(BOUND_VAR_LIST, x, z, y),
+                            d_nodeManager->mkNode(EQUAL, x, y));
+  std::vector<std::vector<Node>> terms(3);
+  for (size_t i = 0; i < 2; i++)
+  {
+    terms[0].push_back(d_skolemManager->mkDummySkolem("a", intType));
+    terms[2].push_back(d_skolemManager->mkDummySkolem("b", intType));
+  }
+  FixedTermProducer inner(terms);
+
+  TermTupleEnumeratorGlobal global;
+  global.d_treg = nullptr;
+  global.d_ml = nullptr;
+  global.d_tuplePredictor = nullptr;
+  TermTupleEnumeratorEnv env;
+  env.d_fullEffort = true;
+  env.d_increaseSum = false;
+  // z has no terms, the order is decided by x and y: the second term of x
+  // scores higher than the second term of y
+  FixedScoreProducer producer(
+      &global, &env, &inner, q, {{0.9, 0.8}, {}, {0.9, 0.1}});
+  env.d_termProducer = &producer;
+  std::unique_ptr<TermTupleEnumeratorInterface> enumerator(
+      mkAStarTermTupleEnumerator(q, &global, &env, &producer));
+  enumerator->init();
+  std::vector<std::vector<size_t>> order;
+  std::vector<Node> tuple;
+  while (enumerator->hasNext())
+  {
+    enumerator->next(tuple);
+    ASSERT_TRUE(tuple[1].isNull());
+    const std::vector<size_t>& indices = enumerator->getCurrentIndices();
+    if (order.empty() || order.back() != indices)
+    {
+      order.push_back(indices);
+    }
+  }
+  const std::vector<std::vector<size_t>> expected = {
+      {0, 0, 0}, {1, 0, 0}, {0, 0, 1}, {1, 0, 1}};
+  ASSERT_EQ(order, expected);
+}
+
+}  // namespace test
+}  // namespace cvc5
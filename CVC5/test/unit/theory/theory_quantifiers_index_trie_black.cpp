@@ -0,0 +1,391 @@
+/******************************************************************************
+ * This file is part of the cvc5 project.
+ *
+ * Copyright (c) 2009-2021 by the authors listed in the file AUTHORS
+ * in the top-level source directory and their institutional affiliations.
+ * All rights reserved.  See the file COPYING in the top-level source
+ * directory for licensing information.
+ * ****************************************************************************
+ *
+ * Black box testing of cvc5::theory::quantifiers::IndexTrie, against the
+ * plain list of the added tuples and the pointer-based trie it replaced. The
+ * latter reports the first subsuming tuple found depth-first rather than the
+ * one with the shortest non-blank prefix, so only the found flags are compared
+ * with it.
+ *
+ * The disabled benchmark (run with --gtest_also_run_disabled_tests) replays a
+ * trace of failure masks, either synthetic or recorded by `-t inst-alg` (the
+ * "failureReason [ 1 _ 3 ]" lines) in the file given by the environment
+ * variable CVC5_INDEX_TRIE_TRACE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "test.h"
+#include "theory/quantifiers/index_trie.h"
+
+namespace cvc5 {
+
+using namespace theory::quantifiers;
+
+namespace test {
+
+/** The pointer-based index trie with unsorted children, as a reference. */
+class PointerIndexTrie
+{
+ public:
+  PointerIndexTrie(bool ignoreFullySpecified)
+      : d_ignoreFullySpecified(ignoreFullySpecified), d_root(new Node())
+  {
+  }
+  ~PointerIndexTrie() { freeRec(d_root); }
+  void add(const std::vector<bool>& mask, const std::vector<size_t>& values)
+  {
+    const size_t cardinality = std::count(mask.begin(), mask.end(), true);
+    if (d_ignoreFullySpecified && cardinality == mask.size())
+    {
+      return;
+    }
+    d_root = addRec(d_root, 0, cardinality, mask, values);
+  }
+  bool find(const std::vector<size_t>& members, size_t& nonBlankLength) const
+  {
+    nonBlankLength = 0;
+    return findRec(d_root, 0, members, nonBlankLength);
+  }
+
+ private:
+  struct Node
+  {
+    std::vector<std::pair<size_t, Node*>> d_children;
+    Node* d_blank = nullptr;
+  };
+  const bool d_ignoreFullySpecified;
+  Node* d_root;
+
+  void freeRec(Node* n)
+  {
+    if (!n)
+    {
+      return;
+    }
+    for (auto c : n->d_children)
+    {
+      freeRec(c.second);
+    }
+    freeRec(n->d_blank);
+    delete n;
+  }
+  bool findRec(const Node* n,
+               size_t index,
+               const std::vector<size_t>& members,
+               size_t& nonBlankLength) const
+  {
+    if (!n || index >= members.size())
+    {
+      return true;
+    }
+    if (n->d_blank && findRec(n->d_blank, index + 1, members, nonBlankLength))
+    {
+      return true;
+    }
+    nonBlankLength = index + 1;
+    for (const auto& c : n->d_children)
+    {
+      if (c.first == members[index]
+          && findRec(c.second, index + 1, members, nonBlankLength))
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+  Node* addRec(Node* n,
+               size_t index,
+               size_t cardinality,
+               const std::vector<bool>& mask,
+               const std::vector<size_t>& values)
+  {
+    if (!n)
+    {
+      return nullptr;
+    }
+    if (cardinality == 0)
+    {
+      freeRec(n);
+      return nullptr;
+    }
+    if (!mask[index])
+    {
+      auto blank = n->d_blank ? n->d_blank : new Node();
+      n->d_blank = addRec(blank, index + 1, cardinality, mask, values);
+      return n;
+    }
+    for (auto& edge : n->d_children)
+    {
+      if (edge.first == values[index])
+      {
+        edge.second =
+            addRec(edge.second, index + 1, cardinality - 1, mask, values);
+        return n;
+      }
+    }
+    auto child = addRec(new Node(), index + 1, cardinality - 1, mask, values);
+    n->d_children.push_back(std::make_pair(values[index], child));
+    return n;
+  }
+};
+
+/** The plain list of the added tuples, as a reference for find. */
+class ListIndexTrie
+{
+ public:
+  ListIndexTrie(bool ignoreFullySpecified)
+      : d_ignoreFullySpecified(ignoreFullySpecified)
+  {
+  }
+  void add(const std::vector<bool>& mask, const std::vector<size_t>& values)
+  {
+    if (!d_ignoreFullySpecified
+        || std::find(mask.begin(), mask.end(), false) != mask.end())
+    {
+      d_masks.push_back(mask);
+      d_values.push_back(values);
+    }
+  }
+  bool find(const std::vector<size_t>& members, size_t& nonBlankLength) const
+  {
+    bool found = false;
+    nonBlankLength = members.size();
+    for (size_t i = 0; i < d_masks.size(); i++)
+    {
+      size_t length = 0;
+      bool subsumes = true;
+      for (size_t j = 0; subsumes && j < members.size(); j++)
+      {
+        subsumes = !d_masks[i][j] || d_values[i][j] == members[j];
+        length = d_masks[i][j] ? j + 1 : length;
+      }
+      if (subsumes && (!found || length < nonBlankLength))
+      {
+        found = true;
+        nonBlankLength = length;
+      }
+    }
+    return found;
+  }
+
+ private:
+  const bool d_ignoreFullySpecified;
+  std::vector<std::vector<bool>> d_masks;
+  std::vector<std::vector<size_t>> d_values;
+};
+
+/** A trace of the enumerator: each failure mask is preceded by the queries
+ * made before it was found. */
+struct TrieTrace
+{
+  std::vector<std::vector<size_t>> d_queries;
+  /** the number of queries before each failure */
+  std::vector<size_t> d_queryEnds;
+  std::vector<std::vector<bool>> d_masks;
+  std::vector<std::vector<size_t>> d_values;
+};
+
+class TestTheoryBlackQuantifiersIndexTrie : public TestInternal
+{
+ protected:
+  /** A synthetic trace, tuples are drawn with a bias to small indices like in
+   * the enumeration, and a failed tuple is disabled by a mask with a few
+   * non-blank positions. */
+  static TrieTrace syntheticTrace(size_t variableCount,
+                                  size_t termCount,
+                                  size_t failureCount,
+                                  unsigned seed)
+  {
+    std::mt19937 rng(seed);
+    std::geometric_distribution<size_t> term(4.0 / termCount);
+    std::bernoulli_distribution fails(0.3);
+    TrieTrace trace;
+    std::vector<size_t> tuple(variableCount);
+    while (trace.d_masks.size() < failureCount)
+    {
+      for (auto& value : tuple)
+      {
+        value = std::min(term(rng), termCount - 1);
+      }
+      trace.d_queries.push_back(tuple);
+      if (!fails(rng))
+      {
+        continue;
+      }
+      std::vector<bool> mask(variableCount, false);
+      const size_t nonBlank = 1 + rng() % std::min<size_t>(variableCount, 3);
+      for (size_t i = 0; i < nonBlank; i++)
+      {
+        mask[rng() % variableCount] = true;
+      }
+      trace.d_queryEnds.push_back(trace.d_queries.size());
+      trace.d_masks.push_back(mask);
+      trace.d_values.push_back(tuple);
+    }
+    return trace;
+  }
+
+  /** A trace recorded by -t inst-alg, queries fill in the blanks of the
+   * failure masks randomly. */
+  static TrieTrace recordedTrace(const std::string& fileName)
+  {
+    std::ifstream in(fileName);
+    std::mt19937 rng(0);
+    TrieTrace trace;
+    std::string line;
+    size_t maxValue = 1;
+    size_t variableCount = 0;
+    while (std::getline(in, line))
+    {
+      const size_t start = line.find("failureReason [");
+      if (start == std::string::npos)
+      {
+        continue;
+      }
+      std::stringstream tokens(line.substr(start + 15));
+      std::vector<bool> mask;
+      std::vector<size_t> values;
+      std::string token;
+      while (tokens >> token && token != "]")
+      {
+        mask.push_back(token != "_");
+        values.push_back(token == "_" ? 0 : std::stoul(token));
+        maxValue = std::max(maxValue, values.back() + 1);
+      }
+      if (variableCount != 0 && variableCount != mask.size())
+      {
+        continue;  // keep the masks of a single arity
+      }
+      variableCount = mask.size();
+      trace.d_masks.push_back(mask);
+      trace.d_values.push_back(values);
+    }
+    for (size_t i = 0; i < trace.d_masks.size(); i++)
+    {
+      for (size_t j = 0; j < 8; j++)
+      {
+        auto query = trace.d_values[i];
+        for (size_t k = 0; k < query.size(); k++)
+        {
+          query[k] = trace.d_masks[i][k] ? query[k] : rng() % maxValue;
+        }
+        trace.d_queries.push_back(query);
+      }
+      trace.d_queryEnds.push_back(trace.d_queries.size());
+    }
+    return trace;
+  }
+
+  /** Replay the trace, returns the found flags of the queries, and their
+   * non-blank lengths in lengths. */
+  template <class Trie>
+  static std::vector<bool> replay(const TrieTrace& trace,
+                                  std::vector<size_t>& lengths)
+  {
+    Trie trie(true);
+    std::vector<bool> results;
+    lengths.clear();
+    size_t query = 0;
+    for (size_t i = 0; i < trace.d_masks.size(); i++)
+    {
+      for (; query < trace.d_queryEnds[i]; query++)
+      {
+        size_t nonBlankLength;
+        results.push_back(trie.find(trace.d_queries[query], nonBlankLength));
+        lengths.push_back(nonBlankLength);
+      }
+      trie.add(trace.d_masks[i], trace.d_values[i]);
+    }
+    return results;
+  }
+
+  template <class Trie>
+  static double timeReplay(const TrieTrace& trace,
+                           size_t repetitions,
+                           std::vector<bool>& results)
+  {
+    std::vector<size_t> lengths;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < repetitions; i++)
+    {
+      results = replay<Trie>(trace, lengths);
+    }
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() / repetitions;
+  }
+};
+
+TEST_F(TestTheoryBlackQuantifiersIndexTrie, subsumption)
+{
+  IndexTrie trie(true);
+  size_t nonBlankLength;
+  ASSERT_FALSE(trie.find({1, 2, 3}, nonBlankLength));
+  ASSERT_EQ(nonBlankLength, 3u);
+  trie.add({false, true, false}, {0, 2, 0});
+  ASSERT_TRUE(trie.find({1, 2, 3}, nonBlankLength));
+  ASSERT_EQ(nonBlankLength, 2u);
+  ASSERT_FALSE(trie.find({1, 3, 3}, nonBlankLength));
+  ASSERT_EQ(nonBlankLength, 3u);
+  trie.add({true, false, true}, {1, 0, 3});
+  ASSERT_TRUE(trie.find({1, 3, 3}, nonBlankLength));
+  ASSERT_EQ(nonBlankLength, 3u);
+  // the subsuming tuple with the shortest non-blank prefix is reported
+  trie.add({false, false, true}, {0, 0, 5});
+  ASSERT_TRUE(trie.find({0, 2, 5}, nonBlankLength));
+  ASSERT_EQ(nonBlankLength, 2u);
+  // fully specified tuples are ignored
+  trie.add({true, true, true}, {4, 4, 4});
+  ASSERT_FALSE(trie.find({4, 4, 4}, nonBlankLength));
+  // the all-blank mask disables everything and frees the nodes
+  trie.add({false, false, false}, {0, 0, 0});
+  ASSERT_TRUE(trie.find({4, 4, 4}, nonBlankLength));
+  ASSERT_EQ(nonBlankLength, 0u);
+  ASSERT_EQ(trie.size(), 0u);
+}
+
+TEST_F(TestTheoryBlackQuantifiersIndexTrie, matches_reference)
+{
+  for (unsigned seed = 0; seed < 20; seed++)
+  {
+    const auto trace = syntheticTrace(1 + seed % 5, 5 + 20 * seed, 500, seed);
+    std::vector<size_t> lengths, listLengths, pointerLengths;
+    const auto found = replay<IndexTrie>(trace, lengths);
+    ASSERT_EQ(found, replay<ListIndexTrie>(trace, listLengths));
+    ASSERT_EQ(lengths, listLengths);
+    ASSERT_EQ(found, replay<PointerIndexTrie>(trace, pointerLengths));
+  }
+}
+
+TEST_F(TestTheoryBlackQuantifiersIndexTrie, DISABLED_benchmark)
+{
+  const char* recorded = std::getenv("CVC5_INDEX_TRIE_TRACE");
+  const auto trace = recorded ? recordedTrace(recorded)
+                              : syntheticTrace(4, 200, 5000, 42);
+  std::vector<bool> flatResults, pointerResults;
+  const double flatTime = timeReplay<IndexTrie>(trace, 5, flatResults);
+  const double pointerTime =
+      timeReplay<PointerIndexTrie>(trace, 5, pointerResults);
+  ASSERT_EQ(flatResults, pointerResults);
+  std::cout << "index trie: " << trace.d_masks.size() << " masks, "
+            << trace.d_queries.size() << " queries, flat " << flatTime
+            << " ms, pointer " << pointerTime << " ms" << std::endl;
+}
+
+}  // namespace test
+}  // namespace cvc5
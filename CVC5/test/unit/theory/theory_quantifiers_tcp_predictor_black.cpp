@@ -0,0 +1,244 @@
+/******************************************************************************
+ * This file is part of the cvc5 project.
+ *
+ * Copyright (c) 2009-2021 by the authors listed in the file AUTHORS
+ * in the top-level source directory and their institutional affiliations.
+ * All rights reserved.  See the file COPYING in the top-level source
+ * directory for licensing information.
+ * ****************************************************************************
+ *
+ * Black box testing of cvc5::TCPClient and cvc5::TCPPredictor against a local
+ * stand-in model server.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+#include "theory/quantifiers/ml.h"
+
+namespace cvc5 {
+namespace test {
+
+/**
+ * A minimal model server speaking the protocol of TCPPredictor. The score of
+ * a row is the sum of its values. The server can delay its replies and close
+ * the connection after each reply.
+ */
+class StandInServer
+{
+ public:
+  StandInServer(int delayMs, bool closeAfterReply)
+      : d_delayMs(delayMs), d_closeAfterReply(closeAfterReply)
+  {
+    d_listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    ::bind(d_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    ::listen(d_listener, 4);
+    socklen_t length = sizeof(address);
+    ::getsockname(
+        d_listener, reinterpret_cast<sockaddr*>(&address), &length);
+    d_port = ntohs(address.sin_port);
+    d_thread = std::thread([this]() { serve(); });
+  }
+  ~StandInServer()
+  {
+    d_stop = true;
+    d_thread.join();
+    ::close(d_listener);
+  }
+  unsigned short port() const { return d_port; }
+  size_t acceptCount() const { return d_acceptCount; }
+
+ private:
+  int d_listener;
+  unsigned short d_port;
+  const int d_delayMs;
+  const bool d_closeAfterReply;
+  std::atomic<bool> d_stop{false};
+  std::atomic<size_t> d_acceptCount{0};
+  std::thread d_thread;
+
+  bool readAll(int fd, char* data, size_t size)
+  {
+    while (size > 0)
+    {
+      const auto received = ::recv(fd, data, size, 0);
+      if (received <= 0)
+      {
+        return false;
+      }
+      data += received;
+      size -= received;
+    }
+    return true;
+  }
+
+  static uint32_t word(const std::string& payload, size_t offset)
+  {
+    uint32_t value;
+    std::memcpy(&value, payload.data() + offset, sizeof(value));
+    return value;  // the tests run on little-endian hosts
+  }
+
+  void serve()
+  {
+    while (!d_stop)
+    {
+      pollfd pfd{d_listener, POLLIN, 0};
+      if (::poll(&pfd, 1, 10) <= 0)
+      {
+        continue;
+      }
+      const int fd = ::accept(d_listener, nullptr, nullptr);
+      if (fd < 0)
+      {
+        continue;
+      }
+      d_acceptCount++;
+      while (!d_stop)
+      {
+        uint32_t header;
+        if (!readAll(fd, reinterpret_cast<char*>(&header), sizeof(header)))
+        {
+          break;
+        }
+        std::string payload(ntohl(header), '\0');
+        if (!readAll(fd, &payload[0], payload.size()))
+        {
+          break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(d_delayMs));
+        std::string reply = "ok";
+        if (payload[0] == 'p')
+        {
+          const uint32_t rowCount = word(payload, 1);
+          const uint32_t entryCount = word(payload, 5);
+          const size_t starts = 9;
+          const size_t values = starts + 4 * (rowCount + 1 + entryCount);
+          reply.clear();
+          for (uint32_t i = 0; i < rowCount; i++)
+          {
+            float sum = 0;
+            for (uint32_t j = word(payload, starts + 4 * i);
+                 j < word(payload, starts + 4 * (i + 1));
+                 j++)
+            {
+              float value;
+              std::memcpy(&value, payload.data() + values + 4 * j, 4);
+              sum += value;
+            }
+            reply.append(reinterpret_cast<const char*>(&sum), sizeof(sum));
+          }
+        }
+        const uint32_t replyHeader = htonl(reply.size());
+        ::send(fd, &replyHeader, sizeof(replyHeader), MSG_NOSIGNAL);
+        ::send(fd, reply.data(), reply.size(), MSG_NOSIGNAL);
+        if (d_closeAfterReply)
+        {
+          break;
+        }
+      }
+      ::close(fd);
+    }
+  }
+};
+
+class TestTheoryBlackQuantifiersTCPPredictor : public TestInternal
+{
+ protected:
+  /** Two rows, {0: 1, 2: 2} and {1: 0.5}. */
+  const std::vector<int32_t> d_rowStarts = {0, 2, 3};
+  const std::vector<int32_t> d_indices = {0, 2, 1};
+  const std::vector<float> d_values = {1, 2, 0.5};
+  /** the result of the last predictBatchCSR */
+  bool d_succeeded = false;
+
+  std::vector<double> predict(TCPPredictor& predictor)
+  {
+    std::vector<double> out(2, -1);
+    d_succeeded = predictor.predictBatchCSR(d_rowStarts.data(),
+                                            d_indices.data(),
+                                            d_values.data(),
+                                            2,
+                                            out.data());
+    return out;
+  }
+};
+
+TEST_F(TestTheoryBlackQuantifiersTCPPredictor, persistent_connection)
+{
+  StandInServer server(0, false);
+  TCPClient client("127.0.0.1", server.port(), 1000);
+  TCPPredictor predictor(&client, 3);
+  for (size_t round = 0; round < 3; round++)
+  {
+    ASSERT_EQ(predict(predictor), std::vector<double>({3, 0.5}));
+    ASSERT_TRUE(d_succeeded);
+  }
+  ASSERT_EQ(client.connectionCount(), 1u);
+  ASSERT_EQ(predictor.failureCount(), 0u);
+  // plain messages use the same framing
+  ASSERT_TRUE(client.sendFrame("a(set-logic ALL)", 16));
+  std::string reply;
+  ASSERT_TRUE(client.receiveFrame(reply));
+  ASSERT_EQ(reply, "ok");
+  ASSERT_EQ(server.acceptCount(), 1u);
+}
+
+TEST_F(TestTheoryBlackQuantifiersTCPPredictor, reconnect)
+{
+  StandInServer server(0, true);
+  TCPClient client("127.0.0.1", server.port(), 1000);
+  TCPPredictor predictor(&client, 3);
+  for (size_t round = 0; round < 3; round++)
+  {
+    ASSERT_EQ(predict(predictor), std::vector<double>({3, 0.5}));
+    // give the server time to close the connection
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  ASSERT_EQ(predictor.failureCount(), 0u);
+  ASSERT_EQ(client.connectionCount(), 3u);
+}
+
+TEST_F(TestTheoryBlackQuantifiersTCPPredictor, timeout_falls_back)
+{
+  StandInServer server(300, false);
+  TCPClient client("127.0.0.1", server.port(), 50);
+  TCPPredictor predictor(&client, 3);
+  ASSERT_EQ(predict(predictor), std::vector<double>({0, 0}));
+  ASSERT_FALSE(d_succeeded);
+  ASSERT_EQ(predictor.failureCount(), 1u);
+  ASSERT_FALSE(client.isOpen());
+}
+
+TEST_F(TestTheoryBlackQuantifiersTCPPredictor, no_server)
+{
+  unsigned short port;
+  {
+    StandInServer server(0, false);
+    port = server.port();
+  }
+  TCPClient client("127.0.0.1", port, 100);
+  TCPPredictor predictor(&client, 3);
+  ASSERT_EQ(predict(predictor), std::vector<double>({0, 0}));
+  ASSERT_FALSE(d_succeeded);
+  ASSERT_EQ(predictor.failureCount(), 1u);
+}
+
+}  // namespace test
+}  // namespace cvc5
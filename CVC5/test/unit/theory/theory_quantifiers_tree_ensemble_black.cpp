@@ -0,0 +1,187 @@
+/******************************************************************************
+ * This file is part of the cvc5 project.
+ *
+ * Copyright (c) 2009-2021 by the authors listed in the file AUTHORS
+ * in the top-level source directory and their institutional affiliations.
+ * All rights reserved.  See the file COPYING in the top-level source
+ * directory for licensing information.
+ * ****************************************************************************
+ *
+ * Black box testing of cvc5::TreeEnsemble, the built-in evaluator of LightGBM
+ * models.
+ */
+
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "test.h"
+#include "theory/quantifiers/tree_ensemble.h"
+
+namespace cvc5 {
+namespace test {
+
+class TestTheoryBlackQuantifiersTreeEnsemble : public TestInternal
+{
+ protected:
+  /**
+   * A small hand-written model with 4 features and two trees. The first tree
+   * has numerical splits with NaN-as-missing (default left), no missing type,
+   * and NaN-as-missing (default right). The second tree has a categorical
+   * split on feature 2 with the category set {0, 2, 4} and a numerical split
+   * with zero-as-missing.
+   */
+  static const char* s_model;
+
+  static double sigmoid(double raw) { return 1.0 / (1.0 + std::exp(-raw)); }
+
+  std::vector<float> rows()
+  {
+    const float nan = NAN;
+    // clang-format off
+    return {0,    0,   0,   0,
+            1,    2,   2,   3,
+            2,    0,   1,   2,
+            2,    nan, 4,   3,
+            nan,  nan, nan, nan,
+            3,    1,   -1,  0,
+            0.25, 0,   5,   0,
+            1,    0,   32,  0};
+    // clang-format on
+  }
+};
+
+const char* TestTheoryBlackQuantifiersTreeEnsemble::s_model =
+    "tree\n"
+    "version=v3\n"
+    "num_class=1\n"
+    "num_tree_per_iteration=1\n"
+    "label_index=0\n"
+    "max_feature_idx=3\n"
+    "objective=binary sigmoid:1\n"
+    "feature_names=f0 f1 f2 f3\n"
+    "feature_infos=[0:8] [0:6] 0:1:2:3:4:5 [0:6]\n"
+    "\n"
+    "Tree=0\n"
+    "num_leaves=4\n"
+    "num_cat=0\n"
+    "split_feature=0 1 3\n"
+    "split_gain=1 1 1\n"
+    "threshold=1.5 1.0000000180025095e-35 2.5\n"
+    "decision_type=10 2 8\n"
+    "left_child=1 -1 -2\n"
+    "right_child=2 -3 -4\n"
+    "leaf_value=0.25 0.5 -0.5 -0.125\n"
+    "leaf_weight=1 1 1 1\n"
+    "leaf_count=1 1 1 1\n"
+    "internal_value=0 0 0\n"
+    "internal_weight=0 0 0\n"
+    "internal_count=4 2 2\n"
+    "is_linear=0\n"
+    "shrinkage=1\n"
+    "\n"
+    "Tree=1\n"
+    "num_leaves=3\n"
+    "num_cat=1\n"
+    "split_feature=2 0\n"
+    "split_gain=1 1\n"
+    "threshold=0 0.5\n"
+    "decision_type=1 4\n"
+    "left_child=-1 -2\n"
+    "right_child=1 -3\n"
+    "leaf_value=0.75 -0.25 0.125\n"
+    "leaf_weight=1 1 1\n"
+    "leaf_count=1 1 1\n"
+    "internal_value=0 0\n"
+    "internal_weight=0 0\n"
+    "internal_count=3 2\n"
+    "cat_boundaries=0 1\n"
+    "cat_threshold=21\n"
+    "is_linear=0\n"
+    "shrinkage=1\n"
+    "\n"
+    "end of trees\n";
+
+TEST_F(TestTheoryBlackQuantifiersTreeEnsemble, load)
+{
+  std::istringstream in(s_model);
+  TreeEnsemble ensemble(in);
+  ASSERT_EQ(ensemble.numberOfFeatures(), 4u);
+  ASSERT_EQ(ensemble.numberOfTrees(), 2u);
+}
+
+TEST_F(TestTheoryBlackQuantifiersTreeEnsemble, predict)
+{
+  std::istringstream in(s_model);
+  TreeEnsemble ensemble(in);
+  const std::vector<float> data = rows();
+  // raw scores worked out by hand, one per row
+  const std::vector<double> raw = {
+      1, 0.25, 0.625, 0.625, 0.375, 0.625, 0, 0.375};
+  ASSERT_EQ(data.size(), 4 * raw.size());
+  for (size_t i = 0; i < raw.size(); i++)
+  {
+    ASSERT_DOUBLE_EQ(ensemble.predict(data.data() + 4 * i), sigmoid(raw[i]));
+  }
+}
+
+TEST_F(TestTheoryBlackQuantifiersTreeEnsemble, predict_batch)
+{
+  std::istringstream in(s_model);
+  TreeEnsemble ensemble(in);
+  // replicate the rows so that the batch spans more than one block
+  std::vector<float> data;
+  for (size_t copy = 0; copy < 20; copy++)
+  {
+    const std::vector<float> r = rows();
+    data.insert(data.end(), r.begin(), r.end());
+  }
+  const size_t rowCount = data.size() / 4;
+  std::vector<double> batch(rowCount);
+  ensemble.predictBatch(data.data(), rowCount, batch.data());
+  for (size_t i = 0; i < rowCount; i++)
+  {
+    ASSERT_EQ(batch[i], ensemble.predict(data.data() + 4 * i));
+  }
+}
+
+#ifdef CVC5_USE_LIGHTGBM
+TEST_F(TestTheoryBlackQuantifiersTreeEnsemble, cross_check_lightgbm)
+{
+  std::istringstream in(s_model);
+  TreeEnsemble ensemble(in);
+  BoosterHandle handle;
+  int iterations;
+  ASSERT_EQ(LGBM_BoosterLoadModelFromString(s_model, &iterations, &handle), 0);
+  ASSERT_EQ(iterations, 2);
+
+  const std::vector<float> data = rows();
+  const size_t rowCount = data.size() / 4;
+  std::vector<double> expected(rowCount), actual(rowCount);
+  int64_t returnSize;
+  ASSERT_EQ(LGBM_BoosterPredictForMat(handle,
+                                      data.data(),
+                                      C_API_DTYPE_FLOAT32,
+                                      rowCount,
+                                      4,
+                                      1,
+                                      C_API_PREDICT_NORMAL,
+                                      0,
+                                      -1,
+                                      "",
+                                      &returnSize,
+                                      expected.data()),
+            0);
+  ASSERT_EQ(returnSize, static_cast<int64_t>(rowCount));
+  ensemble.predictBatch(data.data(), rowCount, actual.data());
+  for (size_t i = 0; i < rowCount; i++)
+  {
+    ASSERT_EQ(actual[i], expected[i]) << "row " << i;
+  }
+  LGBM_BoosterFree(handle);
+}
+#endif
+
+}  // namespace test
+}  // namespace cvc5
@@ -3,6 +3,7 @@
 import os, sys, argparse, subprocess, uuid, re
 import lightgbm as lgb
 from utils import mkdir_if_not_exists, read_lines, write_lines
+from samples import svmlight_lines
 from joblib import Parallel, delayed
 from tqdm import tqdm
 from sklearn.datasets import load_svmlight_file
@@ -153,6 +154,11 @@ def extract_training_examples(log_files, neg_pos_ratio, tuples):
     return examples
 
 def extract_training_examples_1(log_file, tuples):
+    samples_file = log_file + '.samples'
+    if os.path.exists(samples_file):
+        # written by --qlogging-out in solve.sh
+        lines = svmlight_lines(samples_file, tuples)
+        return set(l for l in lines if ' ' in l)
     lines = read_lines(log_file)
     if lines and ('; TUPLE SAMPLES' in lines):
         if tuples :
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""Stand-in model server for cvc5's --tcp-learning and --tcp-model.
+
+Every message is a frame: the payload length as a 4-byte big-endian unsigned
+integer followed by the payload. Prediction requests start with b'p' followed
+by little-endian rowCount (u32), entryCount (u32), rowStarts (i32 x rowCount+1),
+indices (i32 x entryCount) and values (f32 x entryCount); they are answered
+with one little-endian f32 score per row. Any other message (the problem dump
+of --tcp-learning) is answered with b'ok'.
+
+Without --model every term gets the same score, so cvc5 keeps its unguided
+order. --delay and --close make it possible to exercise the timeout and the
+reconnection of the client.
+"""
+import argparse
+import socketserver
+import struct
+import sys
+import time
+
+import numpy as np
+
+
+def read_exactly(stream, size):
+    data = b''
+    while len(data) < size:
+        chunk = stream.read(size - len(data))
+        if not chunk:
+            return None
+        data += chunk
+    return data
+
+
+def read_frame(stream):
+    header = read_exactly(stream, 4)
+    if header is None:
+        return None
+    (size,) = struct.unpack('>I', header)
+    return read_exactly(stream, size)
+
+
+def write_frame(stream, payload):
+    stream.write(struct.pack('>I', len(payload)) + payload)
+    stream.flush()
+
+
+def parse_request(payload):
+    rows, entries = struct.unpack_from('<II', payload, 1)
+    offset = 9
+    row_starts = np.frombuffer(payload, '<i4', rows + 1, offset)
+    offset += 4 * (rows + 1)
+    indices = np.frombuffer(payload, '<i4', entries, offset)
+    offset += 4 * entries
+    values = np.frombuffer(payload, '<f4', entries, offset)
+    return row_starts, indices, values
+
+
+class Predictor:
+    def __init__(self, model_file):
+        self.booster = None
+        if model_file:
+            import lightgbm
+            self.booster = lightgbm.Booster(model_file=model_file)
+
+    def predict(self, row_starts, indices, values):
+        rows = len(row_starts) - 1
+        if self.booster is None:
+            return np.full(rows, 0.5, dtype='<f4')
+        from scipy.sparse import csr_matrix
+        columns = self.booster.num_feature()
+        keep = indices < columns
+        kept = np.concatenate(([0], np.cumsum(keep)))[row_starts]
+        matrix = csr_matrix((values[keep], indices[keep], kept),
+                            shape=(rows, columns))
+        return self.booster.predict(matrix).astype('<f4')
+
+
+def make_handler(args, predictor):
+    class Handler(socketserver.StreamRequestHandler):
+        def handle(self):
+            if args.verbose:
+                print('connection from', self.client_address, file=sys.stderr)
+            while True:
+                payload = read_frame(self.rfile)
+                if payload is None:
+                    return
+                if args.delay:
+                    time.sleep(args.delay / 1000)
+                if payload[:1] == b'p':
+                    scores = predictor.predict(*parse_request(payload))
+                    write_frame(self.wfile, scores.tobytes())
+                else:
+                    write_frame(self.wfile, b'ok')
+                if args.close:
+                    return
+
+    return Handler
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--host', default='127.0.0.1')
+    parser.add_argument('--port', type=int, default=8080)
+    parser.add_argument('--model', default='', help='LightGBM model file')
+    parser.add_argument('--delay', type=int, default=0,
+                        help='milliseconds to wait before each reply')
+    parser.add_argument('--close', action='store_true',
+                        help='close the connection after each reply')
+    parser.add_argument('--verbose', action='store_true')
+    args = parser.parse_args()
+
+    socketserver.ThreadingTCPServer.allow_reuse_address = True
+    with socketserver.ThreadingTCPServer(
+            (args.host, args.port),
+            make_handler(args, Predictor(args.model))) as server:
+        server.serve_forever()
+
+
+if __name__ == '__main__':
+    main()
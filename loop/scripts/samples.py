@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""Reader of the training samples written by cvc5 --qlogging-out=FILE
+--qlogging-format=binary.
+
+The layout is described in CVC5/src/theory/quantifiers/sample_writer.h. The
+file is memory-mapped and the features of the samples are sliced out of the
+mapping without parsing any text.
+"""
+import argparse
+import struct
+
+import numpy as np
+
+MAGIC = b'CVC5SMPL'
+VERSION = 1
+TERM = ord('T')
+TUPLE = ord('U')
+QUANTIFIER = ord('Q')
+
+
+def _byte_order(data):
+    if bytes(data[:8]) != MAGIC:
+        raise ValueError('not a cvc5 sample file')
+    for order in '<>':
+        version, mark = struct.unpack_from(order + 'II', data, 8)
+        if mark == 0x01020304:
+            if version != VERSION:
+                raise ValueError(f'unsupported version {version}')
+            return order
+    raise ValueError('invalid byte order mark')
+
+
+def read_samples(path, tuples=True):
+    """Read the tuple samples (or the term samples if tuples is False).
+
+    Returns the labels, the quantifier ids and the features of the samples,
+    the latter as a list of (indices, values) arrays that point into the
+    mapped file, and the texts of the quantifiers indexed by their ids.
+    """
+    data = np.memmap(path, dtype=np.uint8, mode='r')
+    order = _byte_order(data)
+    wanted = TUPLE if tuples else TERM
+    labels, quantifier_ids, features, quantifiers = [], [], [], []
+    offset = 16
+    while offset < len(data):
+        record = data[offset]
+        offset += 1
+        if record == QUANTIFIER:
+            quantifier_id, length = struct.unpack_from(order + 'II', data,
+                                                       offset)
+            offset += 8
+            assert quantifier_id == len(quantifiers)
+            quantifiers.append(bytes(data[offset:offset + length]).decode())
+            offset += length
+        elif record in (TERM, TUPLE):
+            label, quantifier_id, count = struct.unpack_from(
+                order + 'BII', data, offset)
+            offset += 9
+            if record == wanted:
+                indices = np.frombuffer(data, order + 'i4', count, offset)
+                values = np.frombuffer(data, order + 'f4', count,
+                                       offset + 4 * count)
+                labels.append(label)
+                quantifier_ids.append(quantifier_id)
+                features.append((indices, values))
+            offset += 8 * count
+        else:
+            raise ValueError(f'unknown record {record} at {offset - 1}')
+    return (np.array(labels, dtype=np.int8),
+            np.array(quantifier_ids, dtype=np.uint32), features, quantifiers)
+
+
+def to_csr(features, feature_count=None):
+    """Stack the features of samples into a scipy CSR matrix."""
+    from scipy.sparse import csr_matrix
+    row_starts = np.zeros(len(features) + 1, dtype=np.int64)
+    row_starts[1:] = np.cumsum([len(i) for i, _ in features])
+    indices = np.concatenate([i for i, _ in features] or [[]]).astype(np.int32)
+    values = np.concatenate([v for _, v in features] or [[]]).astype(
+        np.float32)
+    columns = feature_count or (int(indices.max()) + 1 if len(indices) else 0)
+    return csr_matrix((values, indices, row_starts),
+                      shape=(len(features), columns))
+
+
+def svmlight_lines(path, tuples=True):
+    """The samples as lines in the format of the text output of cvc5."""
+    labels, _, features, _ = read_samples(path, tuples)
+    return [' '.join([str(label)]
+                     + [f'{i}:{v:g}' for i, v in zip(indices, values)])
+            for label, (indices, values) in zip(labels, features)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('samples')
+    parser.add_argument('--terms', action='store_true',
+                        help='print the term samples instead of the tuples')
+    args = parser.parse_args()
+    for line in svmlight_lines(args.samples, not args.terms):
+        print(line)
+
+
+if __name__ == '__main__':
+    main()
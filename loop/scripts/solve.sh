@@ -13,6 +13,7 @@ log=$2
 default_options=" --full-saturate-quant --fs-sum --no-e-matching --no-cegqi --no-quant-cf "
 # --e-matching --fs-interleave
 logging_options=" --qlogging --dump-instantiations --print-inst-full --produce-proofs "
+logging_options+=" --qlogging-out=$log.samples --qlogging-format=binary "
 1>&2 echo LGB $lgb_options
 $solver --stats-expert \
     $default_options \